@@ -14,13 +14,65 @@ const string OPERATOR_SYMBOLS[] = {
 	"%", "&", "!", "++", "--", ".", "->", "(", ")", "[", "]", "{", "}", ";", ":", "," 
 };
 
-// set of simple C keywords
-const string KEYWORDS[] = {
+// set of simple C keywords, which cannot be used as identifiers
+constexpr const char *KEYWORDS[] = {
 	"auto", "break", "case", "char", "const", "continue", "default", "do", "double", 
 	"else", "enum", "extern", "float", "for", "goto", "if", "int", "long", "register", 
 	"return", "short", "signed", "sizeof", "static", "struct", "switch", "typedef",
 	"union", "unsigned", "void", "volatile", "while"
-}; // cannot be used as identifiers
+};
+
+const unsigned NUM_KEYWORDS = sizeof(KEYWORDS)/sizeof(KEYWORDS[0]);
+const unsigned MAX_KEYWORD = 8;
+const unsigned TABLE_SIZE = 64;
+
+// perfect hash over the keywords using the length and the first and last
+// characters, so every keyword lands in its own slot of a 64 entry table
+constexpr unsigned keyhash(unsigned first, unsigned last, unsigned length){
+	return (first * 2 + (last + length) * 19) % TABLE_SIZE;
+}
+
+constexpr unsigned length(const char *s){
+	return *s != '\0' ? 1 + length(s + 1) : 0;
+}
+
+constexpr unsigned keyhash(const char *s){
+	return keyhash(s[0], s[length(s) - 1], length(s));
+}
+
+// index of the keyword that hashes to slot h, or NUM_KEYWORDS if none does
+constexpr unsigned slot(unsigned h, unsigned i = 0){
+	return i == NUM_KEYWORDS ? NUM_KEYWORDS : keyhash(KEYWORDS[i]) == h ? i : slot(h, i + 1);
+}
+
+constexpr bool perfect(unsigned i = 0){
+	return i == NUM_KEYWORDS || (slot(keyhash(KEYWORDS[i])) == i && perfect(i + 1));
+}
+
+static_assert(perfect(), "keyword hash has collisions");
+
+// the table itself is filled in by the compiler, one slot() per entry
+template<unsigned... I> struct Slots {
+	static const unsigned char table[sizeof...(I)];
+};
+
+template<unsigned... I>
+const unsigned char Slots<I...>::table[sizeof...(I)] = {slot(I)...};
+
+template<unsigned N, unsigned... I>
+struct Table : Table<N - 1, N - 1, I...> {};
+
+template<unsigned... I>
+struct Table<0, I...> : Slots<I...> {};
+
+// a token is a keyword only if it matches the one keyword in its slot
+bool isKeyword(const string &token){
+	if (token.size() > MAX_KEYWORD){
+		return false;
+	}
+	unsigned i = Table<TABLE_SIZE>::table[keyhash((unsigned char) token[0], (unsigned char) token[token.size() - 1], token.size())];
+	return i < NUM_KEYWORDS && token.compare(KEYWORDS[i]) == 0;
+}
 
 int main(void){
 	string token;
@@ -62,26 +114,13 @@ int main(void){
 		else if (isalpha(c) ||  c == '_'){
 			token += c;
 			c = cin.get();
-			bool only_alpha = true;
-			bool keyword = false;
 			while(isalnum(c) ||  c == '_'){
-				if(!isalpha(c)){
-					only_alpha = false;
-				}
 				token += c;
 				c = cin.get();
 			}
-			if(only_alpha){
-				for (int i = 0; i < sizeof(KEYWORDS)/sizeof(string); ++i){
-					if(KEYWORDS[i].compare(token) == 0){
-						keyword = true;
-						cout << "keyword:" << token << endl;
-						break;
-					}
-				}
-
-			}
-			if(keyword == false){
+			if(isKeyword(token)){
+				cout << "keyword:" << token << endl;
+			}else{
 				cout << "identifier:" << token << endl;
 			}
 			continue;
@@ -0,0 +1,149 @@
+/*
+ * File:	Arena.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		arenas.  Memory is obtained from the heap in large blocks.
+ *		When an arena is reset, only its first block is kept, so
+ *		an arena that was once large for an unusually large
+ *		function doesn't hold onto that memory forever.
+ */
+
+# include <new>
+# include <cstdlib>
+# include "Arena.h"
+
+using namespace std;
+
+static const size_t BLOCK_SIZE = 64 * 1024;
+static const size_t ALIGNMENT = alignof(max_align_t);
+
+Arena *Arena::current = nullptr;
+
+
+/*
+ * Function:	Arena::Arena (constructor)
+ *
+ * Description:	Initialize this arena to be empty.  No memory is obtained
+ *		until the first allocation.
+ */
+
+Arena::Arena()
+    : _next(nullptr), _limit(nullptr), _adopted(nullptr), _first(0), _used(0), _peak(0)
+{
+}
+
+
+/*
+ * Function:	Arena::~Arena (destructor)
+ *
+ * Description:	Destroy every object in this arena and release its memory.
+ */
+
+Arena::~Arena()
+{
+    reset();
+
+    if (!_blocks.empty())
+	free(_blocks[0]);
+}
+
+
+/*
+ * Function:	Arena::allocate
+ *
+ * Description:	Allocate the given number of bytes from this arena.  If
+ *		the current block is too small, we start a new block,
+ *		which is made large enough if the request is unusually
+ *		large.
+ */
+
+void *Arena::allocate(size_t size)
+{
+    size_t capacity;
+    char *p;
+
+
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    if (size > (size_t) (_limit - _next)) {
+	capacity = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+	p = (char *) malloc(capacity);
+
+	if (p == nullptr)
+	    throw bad_alloc();
+
+	if (_blocks.empty())
+	    _first = capacity;
+
+	_blocks.push_back(p);
+	_next = p;
+	_limit = p + capacity;
+    }
+
+    p = _next;
+    _next += size;
+    _used += size;
+
+    if (_used > _peak)
+	_peak = _used;
+
+    return p;
+}
+
+
+/*
+ * Function:	Arena::reset
+ *
+ * Description:	Destroy every adopted object in this arena, most recent
+ *		first, and make its memory available for reuse.  Every
+ *		block other than the first is returned to the heap.
+ */
+
+void Arena::reset()
+{
+    while (_adopted != nullptr) {
+	_adopted->destroy(_adopted->object);
+	_adopted = _adopted->next;
+    }
+
+    while (_blocks.size() > 1) {
+	free(_blocks.back());
+	_blocks.pop_back();
+    }
+
+    if (!_blocks.empty()) {
+	_next = _blocks[0];
+	_limit = _blocks[0] + _first;
+    }
+
+    _used = 0;
+}
+
+
+/*
+ * Function:	Arena::peak (accessor)
+ *
+ * Description:	Return the largest number of bytes ever allocated from
+ *		this arena between resets.
+ */
+
+size_t Arena::peak() const
+{
+    return _peak;
+}
+
+
+/*
+ * Function:	Arena::obtain
+ *
+ * Description:	Allocate the given number of bytes from the current arena,
+ *		or from the heap if there is no current arena.
+ */
+
+void *Arena::obtain(size_t size)
+{
+    if (current != nullptr)
+	return current->allocate(size);
+
+    return ::operator new(size);
+}
@@ -0,0 +1,67 @@
+/*
+ * File:	Arena.h
+ *
+ * Description:	This file contains the class definition for arenas, which
+ *		are regions of memory from which objects are allocated by
+ *		simply bumping a pointer.  Objects in an arena are never
+ *		freed individually.  Instead, the whole arena is reset at
+ *		once, which destroys every object in it and makes its
+ *		memory available again.
+ *
+ *		Abstract syntax trees, symbols, and scopes are allocated
+ *		from the current arena, if there is one, by giving those
+ *		classes their own operator new.  The parser makes an arena
+ *		current while it compiles a function and resets it once
+ *		the function has been generated, so memory is bounded by
+ *		the size of the largest function rather than the size of
+ *		the whole file.
+ *
+ *		Objects whose destructors matter, such as those containing
+ *		strings and vectors, must adopt themselves so the arena
+ *		knows to destroy them when it is reset.  The record of an
+ *		adoption is itself allocated from the arena.
+ */
+
+# ifndef ARENA_H
+# define ARENA_H
+# include <vector>
+# include <cstddef>
+
+class Arena {
+    struct Adoption {
+	Adoption *next;
+	void *object;
+	void (*destroy)(void *);
+    };
+
+    std::vector<char *> _blocks;
+    char *_next, *_limit;
+    Adoption *_adopted;
+    size_t _first, _used, _peak;
+
+    template<class T> static void destroy(void *object) {
+	static_cast<T *>(object)->~T();
+    }
+
+public:
+    static Arena *current;
+
+    Arena();
+    ~Arena();
+
+    void *allocate(size_t size);
+    void reset();
+    size_t peak() const;
+
+    static void *obtain(size_t size);
+
+    template<class T> static void adopt(T *object) {
+	if (current != nullptr) {
+	    Adoption *a = (Adoption *) current->allocate(sizeof(Adoption));
+	    *a = {current->_adopted, object, destroy<T>};
+	    current->_adopted = a;
+	}
+    }
+};
+
+# endif /* ARENA_H */
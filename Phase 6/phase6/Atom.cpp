@@ -0,0 +1,147 @@
+/*
+ * File:	Atom.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		atoms, along with the table of interned names.
+ *
+ *		The names are kept in a deque, so a reference to a name
+ *		stays valid as more names are added.  They are found using
+ *		an open-addressing hash table of atom numbers that is
+ *		doubled in size whenever it becomes half full.  Atom zero
+ *		is reserved for the empty name, so that a default atom is
+ *		always valid.
+ */
+
+# include <deque>
+# include <vector>
+# include <cstring>
+# include "Atom.h"
+
+using namespace std;
+
+static deque<string> names(1);
+static vector<unsigned> table(1024);
+
+
+/*
+ * Function:	hashName (private)
+ *
+ * Description:	Return the FNV-1a hash of the given characters.
+ */
+
+static unsigned hashName(const char *text, unsigned length)
+{
+    unsigned h = 2166136261u;
+
+    while (length -- > 0)
+	h = (h ^ (unsigned char) *text ++) * 16777619u;
+
+    return h;
+}
+
+
+/*
+ * Function:	rehash (private)
+ *
+ * Description:	Double the size of the hash table and reinsert every
+ *		name other than the empty name.
+ */
+
+static void rehash()
+{
+    vector<unsigned> old(table.size() * 2);
+    unsigned mask = old.size() - 1, i;
+
+
+    table.swap(old);
+
+    for (unsigned id = 1; id < names.size(); id ++) {
+	i = hashName(names[id].data(), names[id].size()) & mask;
+
+	while (table[i] != 0)
+	    i = (i + 1) & mask;
+
+	table[i] = id;
+    }
+}
+
+
+/*
+ * Function:	Atom::Atom (constructor)
+ *
+ * Description:	Initialize this atom as the empty name.
+ */
+
+Atom::Atom()
+    : _id(0)
+{
+}
+
+
+/*
+ * Function:	Atom::Atom (constructor)
+ *
+ * Description:	Initialize this atom as the given name, adding the name
+ *		to the table if we haven't seen it before.
+ */
+
+Atom::Atom(const char *text, unsigned length)
+{
+    unsigned mask = table.size() - 1;
+    unsigned i = hashName(text, length) & mask;
+
+
+    while ((_id = table[i]) != 0) {
+	const string &name = names[_id];
+
+	if (name.size() == length && memcmp(name.data(), text, length) == 0)
+	    return;
+
+	i = (i + 1) & mask;
+    }
+
+    if (length == 0)
+	return;
+
+    _id = table[i] = names.size();
+    names.push_back(string(text, length));
+
+    if (names.size() * 2 > table.size())
+	rehash();
+}
+
+
+/*
+ * Function:	Atom::Atom (constructor)
+ *
+ * Description:	Initialize this atom as the given name.
+ */
+
+Atom::Atom(const string &name)
+    : Atom(name.data(), name.size())
+{
+}
+
+
+/*
+ * Function:	Atom::str (accessor)
+ *
+ * Description:	Return the name of this atom.
+ */
+
+const string &Atom::str() const
+{
+    return names[_id];
+}
+
+
+/*
+ * Function:	operator <<
+ *
+ * Description:	Write the name of an atom to a stream.
+ */
+
+ostream &operator <<(ostream &ostr, const Atom &atom)
+{
+    return ostr << atom.str();
+}
@@ -0,0 +1,40 @@
+/*
+ * File:	Atom.h
+ *
+ * Description:	This file contains the class definition for atoms, which
+ *		are interned identifier names.  Every distinct name is
+ *		stored exactly once in a global table, and an atom is just
+ *		the index of its name in that table.  Two atoms are
+ *		therefore equal exactly when their names are equal, and
+ *		comparing them is an integer comparison.
+ *
+ *		An atom is a value type and is small enough that we pass
+ *		it around by value.  Since the whole point is to make
+ *		comparison cheap, the comparison operators are defined
+ *		here in the header, much as Label does with its number.
+ */
+
+# ifndef ATOM_H
+# define ATOM_H
+# include <string>
+# include <ostream>
+
+class Atom {
+    typedef std::string string;
+    unsigned _id;
+
+public:
+    Atom();
+    Atom(const char *text, unsigned length);
+    Atom(const string &name);
+
+    bool operator ==(const Atom &rhs) const { return _id == rhs._id; }
+    bool operator !=(const Atom &rhs) const { return _id != rhs._id; }
+
+    unsigned id() const { return _id; }
+    const string &str() const;
+};
+
+std::ostream &operator <<(std::ostream &ostr, const Atom &atom);
+
+# endif /* ATOM_H */
@@ -0,0 +1,369 @@
+/*
+ * File:	IR.cpp
+ *
+ * Description:	This file contains the constructors and member functions
+ *		for the intermediate representation, along with the
+ *		functions to write it to a stream.
+ *
+ *		An instruction is written as its destination temporary, if
+ *		any, followed by its opcode and operands, so that a
+ *		procedure reads much like the assembly it becomes:
+ *
+ *		    t3 = add t1, t2
+ *		    br lt t3, t4, .L2, .L3
+ */
+
+# include <cassert>
+# include <algorithm>
+# include "IR.h"
+# include "Tree.h"
+
+using namespace std;
+
+static const char *names[] = {
+    "const", "addr", "get", "put", "load", "store", "copy",
+    "add", "sub", "mul", "div", "rem", "neg",
+    "eq", "ne", "lt", "gt", "le", "ge",
+    "call", "phi", "jmp", "br", "ret"
+};
+
+
+/*
+ * Function:	Instruction::Instruction (constructor)
+ *
+ * Description:	Initialize this instruction with the given opcode and
+ *		destination temporary.
+ */
+
+Instruction::Instruction(Opcode opcode, Temp def)
+    : _opcode(opcode), _condition(opcode), _def(def), _value(0), _size(0),
+      _symbol(nullptr), _string(nullptr)
+{
+}
+
+
+/*
+ * Function:	Instruction::isTerminator
+ *
+ * Description:	Return whether this instruction ends a basic block.
+ */
+
+bool Instruction::isTerminator() const
+{
+    return _opcode == JMP || _opcode == BR || _opcode == RET;
+}
+
+
+/*
+ * Function:	Instruction::isPure
+ *
+ * Description:	Return whether this instruction does nothing other than
+ *		compute its result, in which case it need not be executed
+ *		if the result is never used.  A division might trap, but
+ *		then so does the tree, so we need to keep it, unless the
+ *		given instruction defining its divisor is a constant other
+ *		than 0 or -1.
+ */
+
+bool Instruction::isPure(const Instruction *divisor) const
+{
+    switch (_opcode) {
+    case CONSTANT: case ADDRESS: case GET: case LOAD: case COPY:
+    case ADD: case SUB: case MUL: case NEG: case PHI:
+    case EQ: case NE: case LT: case GT: case LE: case GE:
+	return true;
+
+    case DIVIDE: case REMAINDER:
+	return divisor != nullptr && divisor->_opcode == CONSTANT &&
+	    divisor->_value != 0 && divisor->_value != -1;
+
+    default:
+	return false;
+    }
+}
+
+
+/*
+ * Function:	invert
+ *
+ * Description:	Return the condition that is true exactly when the given
+ *		condition is false.
+ */
+
+Opcode invert(Opcode condition)
+{
+    switch (condition) {
+    case EQ: return NE;
+    case NE: return EQ;
+    case LT: return GE;
+    case GE: return LT;
+    case GT: return LE;
+    case LE: return GT;
+    default: assert(0); return condition;
+    }
+}
+
+
+/*
+ * Function:	swap
+ *
+ * Description:	Return the condition that holds with its operands
+ *		exchanged.
+ */
+
+Opcode swap(Opcode condition)
+{
+    switch (condition) {
+    case LT: return GT;
+    case GT: return LT;
+    case LE: return GE;
+    case GE: return LE;
+    default: return condition;
+    }
+}
+
+
+/*
+ * Function:	BasicBlock::BasicBlock (constructor)
+ *
+ * Description:	Initialize this block with the label that names it.
+ */
+
+BasicBlock::BasicBlock(const Label &label)
+    : _label(label), _depth(0)
+{
+}
+
+
+/*
+ * Function:	BasicBlock::~BasicBlock (destructor)
+ *
+ * Description:	Delete the instructions of this block.
+ */
+
+BasicBlock::~BasicBlock()
+{
+    for (auto insn : _insns)
+	delete insn;
+}
+
+
+/*
+ * Function:	BasicBlock::terminator
+ *
+ * Description:	Return the last instruction of this block if it is a
+ *		terminator, and null otherwise.
+ */
+
+Instruction *BasicBlock::terminator() const
+{
+    if (_insns.empty() || !_insns.back()->isTerminator())
+	return nullptr;
+
+    return _insns.back();
+}
+
+
+/*
+ * Function:	Procedure::Procedure (constructor)
+ *
+ * Description:	Initialize this procedure for the given function.
+ */
+
+Procedure::Procedure(const Symbol *id)
+    : _id(id), _temps(0)
+{
+}
+
+
+/*
+ * Function:	Procedure::~Procedure (destructor)
+ *
+ * Description:	Delete the blocks of this procedure.
+ */
+
+Procedure::~Procedure()
+{
+    for (auto block : _blocks)
+	delete block;
+}
+
+
+/*
+ * Function:	Procedure::temp
+ *
+ * Description:	Return a new temporary.
+ */
+
+Temp Procedure::temp()
+{
+    return ++ _temps;
+}
+
+
+/*
+ * Function:	Procedure::link
+ *
+ * Description:	Compute the successors and predecessors of each block, and
+ *		delete any blocks that cannot be reached from the entry,
+ *		such as the code following a return statement.  Any phi
+ *		operands coming from a block that is no longer a
+ *		predecessor are removed as well.
+ */
+
+void Procedure::link()
+{
+    vector<BasicBlock *> work, reached;
+    vector<bool> seen;
+    unsigned i, j, n;
+
+
+    /* Number the blocks and find the successors. */
+
+    n = 0;
+
+    for (auto block : _blocks) {
+	n = max(n, block->_label.number() + 1);
+	block->_preds.clear();
+	block->_succs.clear();
+
+	if (block->terminator() != nullptr)
+	    block->_succs = block->terminator()->_targets;
+    }
+
+
+    /* Find the blocks reachable from the entry, in their original order. */
+
+    seen.resize(n);
+    work.push_back(_blocks[0]);
+    seen[_blocks[0]->_label.number()] = true;
+
+    while (!work.empty()) {
+	BasicBlock *block = work.back();
+	work.pop_back();
+
+	for (auto succ : block->_succs)
+	    if (!seen[succ->_label.number()]) {
+		seen[succ->_label.number()] = true;
+		work.push_back(succ);
+	    }
+    }
+
+    for (auto block : _blocks)
+	if (seen[block->_label.number()])
+	    reached.push_back(block);
+	else
+	    work.push_back(block);
+
+
+    /* Find the predecessors and drop any phi operands from a block that
+       is no longer one, before deleting the unreachable blocks. */
+
+    for (auto block : reached)
+	for (auto succ : block->_succs)
+	    succ->_preds.push_back(block);
+
+    for (auto block : reached)
+	for (auto insn : block->_insns)
+	    if (insn->_opcode == PHI) {
+		for (i = j = 0; i < insn->_uses.size(); i ++)
+		    if (find(block->_preds.begin(), block->_preds.end(),
+			     insn->_targets[i]) != block->_preds.end()) {
+			insn->_uses[j] = insn->_uses[i];
+			insn->_targets[j ++] = insn->_targets[i];
+		    }
+
+		insn->_uses.resize(j);
+		insn->_targets.resize(j);
+	    }
+
+    for (auto block : work)
+	delete block;
+
+    _blocks.swap(reached);
+}
+
+
+/*
+ * Function:	operator <<
+ *
+ * Description:	Write an instruction to a stream.
+ */
+
+ostream &operator <<(ostream &ostr, const Instruction *insn)
+{
+    const vector<Temp> &uses = insn->_uses;
+    Opcode opcode = insn->_opcode;
+
+
+    ostr << "\t";
+
+    if (insn->_def != 0)
+	ostr << "t" << insn->_def << " = ";
+
+    ostr << names[opcode];
+
+    if (opcode == LOAD || opcode == STORE || opcode == GET || opcode == PUT)
+	ostr << "." << insn->_size;
+
+    if (opcode == CONSTANT)
+	ostr << " " << insn->_value;
+
+    else if (opcode == ADDRESS && insn->_string != nullptr)
+	ostr << " \"" << insn->_string->value() << "\"";
+
+    else if (opcode == ADDRESS || opcode == GET)
+	ostr << " " << insn->_symbol->name();
+
+    else if (opcode == PUT)
+	ostr << " " << insn->_symbol->name() << ", t" << uses[0];
+
+    else if (opcode == CALL) {
+	ostr << " " << insn->_symbol->name() << "(";
+
+	for (unsigned i = 0; i < uses.size(); i ++)
+	    ostr << (i > 0 ? ", t" : "t") << uses[i];
+
+	ostr << ")";
+
+    } else if (opcode == PHI) {
+	for (unsigned i = 0; i < uses.size(); i ++) {
+	    ostr << (i > 0 ? ", [t" : " [t") << uses[i] << ", ";
+	    ostr << insn->_targets[i]->_label << "]";
+	}
+
+    } else if (opcode == JMP)
+	ostr << " " << insn->_targets[0]->_label;
+
+    else if (opcode == BR) {
+	ostr << " " << names[insn->_condition] << " t" << uses[0];
+	ostr << ", t" << uses[1] << ", " << insn->_targets[0]->_label;
+	ostr << ", " << insn->_targets[1]->_label;
+
+    } else
+	for (unsigned i = 0; i < uses.size(); i ++)
+	    ostr << (i > 0 ? ", t" : " t") << uses[i];
+
+    return ostr << "\n";
+}
+
+
+/*
+ * Function:	Procedure::write
+ *
+ * Description:	Write this procedure to a stream.
+ */
+
+void Procedure::write(ostream &ostr) const
+{
+    ostr << "function " << _id->name() << "\n";
+
+    for (auto block : _blocks) {
+	ostr << block->_label << ":\n";
+
+	for (auto insn : block->_insns)
+	    ostr << insn;
+    }
+
+    ostr << "\n";
+}
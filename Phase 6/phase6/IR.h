@@ -0,0 +1,113 @@
+/*
+ * File:	IR.h
+ *
+ * Description:	This file contains the class definitions for the linear
+ *		intermediate representation (IR) of Simple C functions.
+ *
+ *		A procedure is a list of basic blocks, and a basic block is
+ *		a list of three-address instructions, the last of which is
+ *		always a jump, a branch, or a return.  Each block is named
+ *		by a label, which is how the blocks are built in the first
+ *		place: the labels used by the tree for loops, if-statements
+ *		and logical operators each start a new block.
+ *
+ *		Instructions operate on an unlimited number of temporaries
+ *		(virtual registers), which are numbered from one.  Variables
+ *		are never operands.  Instead, they are read and written
+ *		with explicit GET and PUT instructions, and memory through
+ *		a pointer is accessed with explicit LOAD and STORE
+ *		instructions.  The temporaries of a freshly lowered
+ *		procedure are each defined exactly once, except for those
+ *		defined by PHI instructions joining the values of logical
+ *		expressions.
+ *
+ *		IR.h - class definitions
+ *		IR.cpp - constructors and writing the IR to a stream
+ *		lowerer.cpp - translating the tree into the IR
+ *		optimizer.cpp - optimizing the IR
+ *		selector.cpp - selecting instructions from the IR
+ *
+ *		Much like the tree, the data members are public since the
+ *		IR is built and rewritten by several separate passes.
+ */
+
+# ifndef IR_H
+# define IR_H
+# include <atomic>
+# include <vector>
+# include <ostream>
+# include "Label.h"
+# include "Symbol.h"
+
+typedef unsigned Temp;
+
+enum Opcode {
+    CONSTANT, ADDRESS, GET, PUT, LOAD, STORE, COPY,
+    ADD, SUB, MUL, DIVIDE, REMAINDER, NEG,
+    EQ, NE, LT, GT, LE, GE,
+    CALL, PHI, JMP, BR, RET
+};
+
+
+/* A single instruction: def = opcode uses */
+
+class Instruction {
+public:
+    Opcode _opcode;
+    Opcode _condition;
+    Temp _def;
+    std::vector<Temp> _uses;
+    std::vector<class BasicBlock *> _targets;
+    int _value;
+    unsigned _size;
+    const Symbol *_symbol;
+    const class String *_string;
+
+    Instruction(Opcode opcode, Temp def = 0);
+    bool isTerminator() const;
+    bool isPure(const Instruction *divisor = nullptr) const;
+};
+
+std::ostream &operator <<(std::ostream &ostr, const Instruction *insn);
+
+
+/* A basic block */
+
+class BasicBlock {
+public:
+    Label _label;
+    std::vector<Instruction *> _insns;
+    std::vector<BasicBlock *> _preds, _succs;
+    unsigned _depth;
+
+    BasicBlock(const Label &label);
+    ~BasicBlock();
+    Instruction *terminator() const;
+};
+
+
+/* A procedure (i.e., the IR of a function definition) */
+
+class Procedure {
+public:
+    const Symbol *_id;
+    std::vector<BasicBlock *> _blocks;
+    Temp _temps;
+
+    Procedure(const Symbol *id);
+    ~Procedure();
+
+    Temp temp();
+    void link();
+    void optimize(unsigned level);
+    void write(std::ostream &ostr) const;
+    void select(std::ostream &ostr, int offset);
+};
+
+extern std::atomic<unsigned long> recomputations, forwarded, hoisted, reduced,
+    replaced;
+
+Opcode invert(Opcode condition);
+Opcode swap(Opcode condition);
+
+# endif /* IR_H */
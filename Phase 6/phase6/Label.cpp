@@ -5,12 +5,23 @@
 
 using namespace std;
 
-unsigned Label::_counter = 0;
+thread_local unsigned Label::_counter = 0;
 
 Label::Label() {
     _number = _counter++;
 }
 
+// Labels are numbered from zero in each function, so the number is
+// written after a marker and fixed up when the function is output.
+
+void Label::restart() {
+    _counter = 0;
+}
+
+unsigned Label::count() {
+    return _counter;
+}
+
 ostream &operator <<(ostream &ostr, const Label &label) {
-    return ostr << label_prefix << label.number();
-}
\ No newline at end of file
+    return ostr << label_prefix << Label::marker << label.number();
+}
@@ -2,11 +2,15 @@
 # define LABEL_H
 # include <iostream>
 class Label {
-    static unsigned _counter;
+    static thread_local unsigned _counter;
     unsigned _number;
 public:
+    static const char marker = '\001';
+
     Label();
     unsigned number() const { return _number;}
+    static void restart();
+    static unsigned count();
 };
 
 std::ostream &operator <<(std::ostream &ostr, const Label &label);
@@ -0,0 +1,218 @@
+/*
+ * File:	Output.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the buffered assembly output.  We go straight to the file
+ *		descriptor with write(2) so that there is exactly one
+ *		system call per buffer full, no matter how the C++ library
+ *		decides to buffer cout.
+ */
+
+# include <cerrno>
+# include <fcntl.h>
+# include <unistd.h>
+# include "Output.h"
+
+using namespace std;
+
+
+/*
+ * Function:	Output::Output (constructor)
+ *
+ * Description:	Initialize this output object to write to the standard
+ *		output using a buffer of the given capacity.
+ */
+
+Output::Output(size_t capacity)
+    : _fd(1), _buffer(new char[capacity]), _capacity(capacity), _written(0),
+      _failed(false)
+{
+    setp(_buffer, _buffer + _capacity);
+}
+
+
+/*
+ * Function:	Output::~Output (destructor)
+ *
+ * Description:	Write anything still pending and release the buffer.  We
+ *		only close the file descriptor if we opened it ourselves.
+ */
+
+Output::~Output()
+{
+    drain();
+
+    if (_fd != 1)
+	close(_fd);
+
+    delete[] _buffer;
+}
+
+
+/*
+ * Function:	Output::open
+ *
+ * Description:	Redirect this output to the file with the given path,
+ *		which is created or truncated.  Anything pending for the
+ *		old file descriptor is written first.
+ */
+
+bool Output::open(const string &path)
+{
+    int fd;
+
+
+    drain();
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (fd < 0)
+	return false;
+
+    if (_fd != 1)
+	close(_fd);
+
+    _fd = fd;
+    return true;
+}
+
+
+/*
+ * Function:	Output::flush
+ *
+ * Description:	Write anything still pending and return whether all the
+ *		output has been written successfully.
+ */
+
+bool Output::flush()
+{
+    return drain() && !_failed;
+}
+
+
+/*
+ * Function:	Output::written (accessor)
+ *
+ * Description:	Return the total number of bytes written so far,
+ *		including those still pending in the buffer.
+ */
+
+unsigned long Output::written() const
+{
+    return _written + (pptr() - pbase());
+}
+
+
+/*
+ * Function:	Output::drain (private)
+ *
+ * Description:	Write the contents of the buffer to the file descriptor
+ *		and reset the buffer to empty.  A short write is simply
+ *		continued, as is an interrupted one.  Any other failure
+ *		is recorded and the contents of the buffer are discarded,
+ *		since they can never be written.
+ */
+
+bool Output::drain()
+{
+    char *p = pbase();
+    ssize_t n;
+
+
+    while (p < pptr()) {
+	n = write(_fd, p, pptr() - p);
+
+	if (n < 0) {
+	    if (errno == EINTR)
+		continue;
+
+	    _failed = true;
+	    setp(_buffer, _buffer + _capacity);
+	    return false;
+	}
+
+	p += n;
+    }
+
+    _written += pptr() - pbase();
+    setp(_buffer, _buffer + _capacity);
+    return true;
+}
+
+
+/*
+ * Function:	Output::overflow
+ *
+ * Description:	Called by the stream when the buffer is full.  Write the
+ *		buffer and then store the given character.
+ */
+
+Output::int_type Output::overflow(int_type c)
+{
+    if (!drain())
+	return traits_type::eof();
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+	*pptr() = traits_type::to_char_type(c);
+	pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+
+/*
+ * Function:	Output::xsputn
+ *
+ * Description:	Write a sequence of characters.  Most writes are small
+ *		and just copied into the buffer.  Anything larger than the
+ *		buffer bypasses it altogether.
+ */
+
+streamsize Output::xsputn(const char *s, streamsize n)
+{
+    streamsize count, total = n;
+    ssize_t written;
+
+
+    while (n > 0) {
+	if (epptr() == pptr() && !drain())
+	    return total - n;
+
+	if (pptr() == pbase() && (size_t) n >= _capacity) {
+	    written = write(_fd, s, n);
+
+	    if (written < 0) {
+		if (errno == EINTR)
+		    continue;
+
+		_failed = true;
+		return total - n;
+	    }
+
+	    _written += written;
+	    s += written;
+	    n -= written;
+	    continue;
+	}
+
+	count = min(n, (streamsize) (epptr() - pptr()));
+	traits_type::copy(pptr(), s, count);
+	pbump(count);
+	s += count;
+	n -= count;
+    }
+
+    return total;
+}
+
+
+/*
+ * Function:	Output::sync
+ *
+ * Description:	Called by the stream when it is explicitly flushed.
+ */
+
+int Output::sync()
+{
+    return drain() ? 0 : -1;
+}
@@ -0,0 +1,48 @@
+/*
+ * File:	Output.h
+ *
+ * Description:	This file contains the class definition for the buffered
+ *		output of the generated assembly code.  Everything written
+ *		is accumulated in a large in-memory buffer, which is only
+ *		written to the underlying file descriptor when it fills or
+ *		when it is explicitly flushed.  In contrast, std::endl on
+ *		cout flushes the stream after every line, which costs us a
+ *		system call for every instruction we generate.
+ *
+ *		The class is a stream buffer, so it is used by attaching
+ *		it to an ordinary output stream.  A failed write is
+ *		remembered, so that it can be reported once everything
+ *		has been flushed.
+ */
+
+# ifndef OUTPUT_H
+# define OUTPUT_H
+# include <string>
+# include <streambuf>
+
+class Output : public std::streambuf {
+    typedef std::string string;
+
+    int _fd;
+    char *_buffer;
+    size_t _capacity;
+    unsigned long _written;
+    bool _failed;
+
+    bool drain();
+
+protected:
+    virtual int_type overflow(int_type c);
+    virtual std::streamsize xsputn(const char *s, std::streamsize n);
+    virtual int sync();
+
+public:
+    Output(size_t capacity = 1 << 20);
+    ~Output();
+
+    bool open(const string &path);
+    bool flush();
+    unsigned long written() const;
+};
+
+# endif /* OUTPUT_H */
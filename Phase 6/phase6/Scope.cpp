@@ -11,11 +11,32 @@
  *
  *		Extra functionality:
  *		- retrieving the vector of symbols
+ *		- hashing the symbols of large scopes
+ *		- allocation from an arena
  */
 
 # include <cassert>
 # include "Scope.h"
 
+using namespace std;
+
+static const unsigned LINEAR_LIMIT = 8;
+static const unsigned EMPTY = 0, DELETED = ~0u;
+
+
+/*
+ * Function:	hashAtom (private)
+ *
+ * Description:	Return the starting slot for the given name in an index of
+ *		the given size.  Atoms are small consecutive integers, so
+ *		multiplying by an odd constant spreads them out well.
+ */
+
+static unsigned hashAtom(const Atom &name, unsigned size)
+{
+    return (name.id() * 2654435761u) & (size - 1);
+}
+
 
 /*
  * Function:	Scope::Scope (constructor)
@@ -24,8 +45,87 @@
  */
 
 Scope::Scope(Scope *enclosing)
-    : _enclosing(enclosing)
+    : _enclosing(enclosing), _holes(0)
+{
+    Arena::adopt(this);
+}
+
+
+/*
+ * Function:	Scope::operator new
+ *
+ * Description:	Allocate a scope from the current arena.
+ */
+
+void *Scope::operator new(size_t size)
+{
+    return Arena::obtain(size);
+}
+
+
+/*
+ * Function:	Scope::operator delete
+ *
+ * Description:	Do nothing, since a scope in an arena is destroyed and
+ *		freed when the arena is reset.
+ */
+
+void Scope::operator delete(void *object)
+{
+}
+
+
+/*
+ * Function:	Scope::probe (private)
+ *
+ * Description:	Return the slot in the index that refers to the symbol
+ *		with the given name, or the empty slot where such a symbol
+ *		would go.  Each slot holds one more than the position of a
+ *		symbol in the vector, or else EMPTY or DELETED.
+ */
+
+unsigned Scope::probe(const Atom &name) const
 {
+    unsigned i = hashAtom(name, _index.size()), entry;
+
+
+    while ((entry = _index[i]) != EMPTY) {
+	if (entry != DELETED && _symbols[entry - 1]->name() == name)
+	    break;
+
+	i = (i + 1) & (_index.size() - 1);
+    }
+
+    return i;
+}
+
+
+/*
+ * Function:	Scope::rehash (private)
+ *
+ * Description:	Squeeze out any holes left by removed symbols and rebuild
+ *		the index so that it is at most one-quarter full.
+ */
+
+void Scope::rehash() const
+{
+    unsigned size = 16, n = 0;
+
+
+    for (unsigned i = 0; i < _symbols.size(); i ++)
+	if (_symbols[i] != nullptr)
+	    _symbols[n ++] = _symbols[i];
+
+    _symbols.resize(n);
+    _holes = 0;
+
+    while (size < 4 * n)
+	size *= 2;
+
+    _index.assign(size, EMPTY);
+
+    for (unsigned i = 0; i < n; i ++)
+	_index[probe(_symbols[i]->name())] = i + 1;
 }
 
 
@@ -36,11 +136,16 @@ Scope::Scope(Scope *enclosing)
  *		already be inserted, or we fail big time.
  */
 
-
 void Scope::insert(Symbol *symbol)
 {
     assert(find(symbol->name()) == nullptr);
     _symbols.push_back(symbol);
+
+    if (_index.empty() ? _symbols.size() > LINEAR_LIMIT : 2 * _symbols.size() > _index.size())
+	rehash();
+
+    else if (!_index.empty())
+	_index[probe(symbol->name())] = _symbols.size();
 }
 
 
@@ -49,15 +154,24 @@ void Scope::insert(Symbol *symbol)
  *
  * Description:	Find and return the symbol with the given name in this
  *		scope.  If no such symbol is found, return a null pointer.
+ *		Small scopes are simply searched in order.
  */
 
-Symbol *Scope::find(const string &name) const
+Symbol *Scope::find(const Atom &name) const
 {
-    for (auto symbol : _symbols)
-	if (name == symbol->name())
-	    return symbol;
+    unsigned entry;
+
+
+    if (_index.empty()) {
+	for (auto symbol : _symbols)
+	    if (name == symbol->name())
+		return symbol;
+
+	return nullptr;
+    }
 
-    return nullptr;
+    entry = _index[probe(name)];
+    return entry != EMPTY ? _symbols[entry - 1] : nullptr;
 }
 
 
@@ -65,16 +179,32 @@ Symbol *Scope::find(const string &name) const
  * Function:	Scope::remove
  *
  * Description:	Remove the symbol with the given name from this scope.
- *		And, yes, I didn't use an iterator.  So sue me.
+ *		And, yes, I didn't use an iterator for a small scope.  So
+ *		sue me.  In a large scope, we leave a hole for later.
  */
 
-void Scope::remove(const string &name)
+void Scope::remove(const Atom &name)
 {
-    for (unsigned i = 0; i < _symbols.size(); i ++)
-	if (name == _symbols[i]->name()) {
-	    _symbols.erase(_symbols.begin() + i);
-	    break;
-	}
+    unsigned i;
+
+
+    if (_index.empty()) {
+	for (i = 0; i < _symbols.size(); i ++)
+	    if (name == _symbols[i]->name()) {
+		_symbols.erase(_symbols.begin() + i);
+		break;
+	    }
+
+	return;
+    }
+
+    i = probe(name);
+
+    if (_index[i] != EMPTY) {
+	_symbols[_index[i] - 1] = nullptr;
+	_index[i] = DELETED;
+	_holes ++;
+    }
 }
 
 
@@ -87,7 +217,7 @@ void Scope::remove(const string &name)
  *		null pointer.
  */
 
-Symbol *Scope::lookup(const string &name) const
+Symbol *Scope::lookup(const Atom &name) const
 {
     Symbol *symbol;
 
@@ -114,10 +244,14 @@ Scope *Scope::enclosing() const
 /*
  * Function:	Scope::symbols (accessor)
  *
- * Description:	Return the list of symbols in this scope.
+ * Description:	Return the list of symbols in this scope in the order in
+ *		which they were inserted.
  */
 
 const Symbols &Scope::symbols() const
 {
+    if (_holes > 0)
+	rehash();
+
     return _symbols;
 }
@@ -5,35 +5,53 @@
  *		Simple C.  A scope consists simply of a list of symbols.
  *		We use a vector rather than a map because we want to keep
  *		the symbols in insertion order, and we expect the number of
- *		symbols inserted to be small.
+ *		symbols inserted to usually be small.  However, the global
+ *		scope of machine-generated code can be very large, so once
+ *		a scope grows beyond a handful of symbols, we also keep an
+ *		open-addressing hash index into the vector, keyed by the
+ *		atom of each symbol's name.
+ *
+ *		Removing a symbol just leaves a hole in the vector, which
+ *		is squeezed out the next time the symbols are requested,
+ *		so that removal doesn't have to shift the whole vector.
  *
  *		Each scope has a link to its enclosing scope.  By
  *		convention, a null scope is used if there is no enclosing
  *		scope.  The find function searches only the given scope,
  *		whereas the lookup function searches the given scope and
  *		all enclosing scopes.
+ *
+ *		Like symbols, scopes are allocated from the current arena,
+ *		if there is one.
  */
 
 # ifndef SCOPE_H
 # define SCOPE_H
 # include "Symbol.h"
+# include "Arena.h"
 # include <vector>
 
 typedef std::vector<Symbol *> Symbols;
 
 class Scope {
-    typedef std::string string;
-
     Scope *_enclosing;
-    Symbols _symbols;
+    mutable Symbols _symbols;
+    mutable std::vector<unsigned> _index;
+    mutable unsigned _holes;
+
+    unsigned probe(const Atom &name) const;
+    void rehash() const;
 
 public:
     Scope(Scope *enclosing = nullptr);
+    void *operator new(size_t size);
+    void operator delete(void *object);
+
 
     void insert(Symbol *symbol);
-    void remove(const string &name);
-    Symbol *find(const string &name) const;
-    Symbol *lookup(const string &name) const;
+    void remove(const Atom &name);
+    Symbol *find(const Atom &name) const;
+    Symbol *lookup(const Atom &name) const;
 
     Scope *enclosing() const;
     const Symbols &symbols() const;
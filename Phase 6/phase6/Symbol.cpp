@@ -8,8 +8,6 @@
 
 # include "Symbol.h"
 
-using std::string;
-
 
 /*
  * Function:	Symbol::Symbol (constructor)
@@ -17,8 +15,33 @@ using std::string;
  * Description:	Initialize a symbol object.
  */
 
-Symbol::Symbol(const string &name, const Type &type)
-    : _name(name), _type(type), _offset(0)
+Symbol::Symbol(const Atom &name, const Type &type)
+    : _name(name), _type(type), _offset(0), _register(nullptr), _hint(false)
+{
+}
+
+
+/*
+ * Function:	Symbol::operator new
+ *
+ * Description:	Allocate a symbol from the current arena.
+ */
+
+void *Symbol::operator new(size_t size)
+{
+    return Arena::obtain(size);
+}
+
+
+/*
+ * Function:	Symbol::operator delete
+ *
+ * Description:	Do nothing, since a symbol in an arena is freed along with
+ *		the arena.  A symbol allocated with ::new must be deleted
+ *		with ::delete.
+ */
+
+void Symbol::operator delete(void *object)
 {
 }
 
@@ -29,7 +52,7 @@ Symbol::Symbol(const string &name, const Type &type)
  * Description:	Return the name of this symbol.
  */
 
-const string &Symbol::name() const
+const Atom &Symbol::name() const
 {
     return _name;
 }
@@ -3,24 +3,38 @@
  *
  * Description:	This file contains the class definition for symbols in
  *		Simple C.  At this point, a symbol merely consists of a
- *		name and a type, neither of which you can change.
+ *		name and a type, neither of which you can change.  The name
+ *		is an atom, so comparing names is cheap.  A local variable
+ *		may also be kept in a register by the generator, and may
+ *		have been declared with register as a hint to do so.
+ *
+ *		Symbols are allocated from the current arena, if there is
+ *		one.  Symbols that must outlive it, such as those in the
+ *		outermost scope, should be allocated with ::new instead.
  */
 
 # ifndef SYMBOL_H
 # define SYMBOL_H
-# include <string>
+# include "Atom.h"
 # include "Type.h"
+# include "Arena.h"
+
+class Register;
 
 class Symbol {
-    typedef std::string string;
-    string _name;
+    Atom _name;
     Type _type;
 
 public:
     int _offset;
+    Register *_register;
+    bool _hint;
+
+    Symbol(const Atom &name, const Type &type);
+    void *operator new(size_t size);
+    void operator delete(void *object);
 
-    Symbol(const string &name, const Type &type);
-    const string &name() const;
+    const Atom &name() const;
     const Type &type() const;
 };
 
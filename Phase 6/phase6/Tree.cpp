@@ -15,10 +15,15 @@
  *		anything interesting, and could easily be put in the header
  *		file, but we don't like to do that.
  *
+ *		Only nodes with strings or vectors need to be destroyed,
+ *		so only those adopt themselves into the current arena.
+ *		The others are simply forgotten when it is reset.
+ *
  *		Extra functionality:
  *		- everything (it is optional to construct an AST)
  */
 
+# include <algorithm>
 # include <cstdlib>
 # include <sstream>
 # include "tokens.h"
@@ -35,7 +40,9 @@ using namespace std;
  */
 
 Expression::Expression(const Type &type)
-    : _type(type), _lvalue(false), _offset(0), _hasCall(false), _register(nullptr)
+    : _type(type), _lvalue(false), _offset(0), _use(0), _need(1),
+      _hasCall(false),
+      _register(nullptr)
 {
 }
 
@@ -68,13 +75,55 @@ bool Expression::lvalue() const
  * Function:	Binary::Binary (constructor)
  *
  * Description:	Initialize this expression as a binary operator with the
- *		specified children.
+ *		specified children.  The number of registers needed to
+ *		compute it is its Sethi-Ullman (or Ershov) number: the
+ *		larger of the numbers of its children if they differ, and
+ *		one more otherwise.  A number or variable as the right
+ *		operand needs no register since it can be used directly
+ *		as the source operand of the instruction.
  */
 
 Binary::Binary(Expression *left, Expression *right, const Type &type)
     : Expression(type), _left(left), _right(right)
 {
+    const Symbol *symbol;
+    unsigned value, need;
+
+
     _hasCall = left->_hasCall | right->_hasCall;
+
+    if (right->isNumber(value) || right->isIdentifier(symbol))
+	need = 0;
+    else
+	need = right->_need;
+
+    _need = (left->_need == need ? need + 1 : max(left->_need, need));
+}
+
+
+/*
+ * Function:	Binary::rightFirst
+ *
+ * Description:	Return whether the right operand of a binary operator
+ *		should be computed before the left operand.  The operand
+ *		needing more registers is computed first, so that the
+ *		other operand is not held in a register meanwhile.  An
+ *		operand containing a call is computed first as well, since
+ *		anything in a register is spilled across the call.
+ *		However, the operands are never reordered if the left
+ *		operand has a call, so that calls are always made in
+ *		order.
+ */
+
+bool Binary::rightFirst(const Expression *left, const Expression *right)
+{
+    if (left->_hasCall)
+	return false;
+
+    if (right->_hasCall)
+	return true;
+
+    return right->_need > left->_need;
 }
 
 
@@ -89,6 +138,7 @@ Unary::Unary(Expression *expr, const Type &type)
     : Expression(type), _expr(expr)
 {
     _hasCall = expr->_hasCall;
+    _need = expr->_need;
 }
 
 
@@ -101,6 +151,7 @@ Unary::Unary(Expression *expr, const Type &type)
 String::String(const string &value)
     : Expression(Type(CHAR, 0, value.size() + 1)), _value(value)
 {
+    Arena::adopt(this);
 }
 
 
@@ -145,7 +196,8 @@ const Symbol *Identifier::symbol() const
 /*
  * Function:	Number::Number (constructor)
  *
- * Description:	Initialize a number, which always has type int.
+ * Description:	Initialize a number, which always has type int, so it is
+ *		written as signed.
  */
 
 Number::Number(unsigned value)
@@ -153,7 +205,8 @@ Number::Number(unsigned value)
 {
     stringstream ss;
 
-    ss << value;
+    Arena::adopt(this);
+    ss << (int) value;
     _value = ss.str();
 }
 
@@ -167,6 +220,7 @@ Number::Number(unsigned value)
 Number::Number(const string &value)
     : Expression(Type(INT)), _value(value)
 {
+    Arena::adopt(this);
 }
 
 
@@ -191,6 +245,7 @@ const string &Number::value() const
 Call::Call(const Symbol *id, const Expressions &args, const Type &type)
     : Expression(type), _id(id), _args(args)
 {
+    Arena::adopt(this);
     _hasCall = true;
 }
 
@@ -445,6 +500,7 @@ Return::Return(Expression *expr)
 Block::Block(Scope *decls, const Statements &stmts)
     : _decls(decls), _stmts(stmts)
 {
+    Arena::adopt(this);
 }
 
 
@@ -568,3 +624,254 @@ bool Dereference::isDereference(Expression *&pointer) const
     pointer = _expr;
     return true;
 }
+
+
+/*
+ * Function:	Expression::isAddress (accessor)
+ *
+ * Description:	Return false since most expressions are not addresses.
+ */
+
+bool Expression::isAddress(Expression *&expr) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Address::isAddress (accessor)
+ *
+ * Description:	Return true since an address is in fact an address.
+ */
+
+bool Address::isAddress(Expression *&expr) const
+{
+    expr = _expr;
+    return true;
+}
+
+
+/*
+ * Function:	Expression::isAdd (accessor)
+ *
+ * Description:	Return false since most expressions are not additions.
+ */
+
+bool Expression::isAdd(Expression *&left, Expression *&right) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Add::isAdd (accessor)
+ *
+ * Description:	Return true since an addition is in fact an addition.
+ */
+
+bool Add::isAdd(Expression *&left, Expression *&right) const
+{
+    left = _left;
+    right = _right;
+    return true;
+}
+
+
+/*
+ * Function:	Expression::isSubtract (accessor)
+ *
+ * Description:	Return false since most expressions are not subtractions.
+ */
+
+bool Expression::isSubtract(Expression *&left, Expression *&right) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Subtract::isSubtract (accessor)
+ *
+ * Description:	Return true since a subtraction is in fact a subtraction.
+ */
+
+bool Subtract::isSubtract(Expression *&left, Expression *&right) const
+{
+    left = _left;
+    right = _right;
+    return true;
+}
+
+
+/*
+ * Function:	Expression::isMultiply (accessor)
+ *
+ * Description:	Return false since most expressions are not
+ *		multiplications.
+ */
+
+bool Expression::isMultiply(Expression *&left, Expression *&right) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Multiply::isMultiply (accessor)
+ *
+ * Description:	Return true since a multiplication is in fact a
+ *		multiplication.
+ */
+
+bool Multiply::isMultiply(Expression *&left, Expression *&right) const
+{
+    left = _left;
+    right = _right;
+    return true;
+}
+
+
+/*
+ * Function:	Expression::isBoolean (accessor)
+ *
+ * Description:	Return false since most expressions can have values other
+ *		than zero and one.
+ */
+
+bool Expression::isBoolean() const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Not::isBoolean (accessor)
+ *
+ * Description:	Return true since a logical negation is always zero or one.
+ */
+
+bool Not::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	LessThan::isBoolean (accessor)
+ *
+ * Description:	Return true since a comparison is always zero or one.
+ */
+
+bool LessThan::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	GreaterThan::isBoolean (accessor)
+ *
+ * Description:	Return true since a comparison is always zero or one.
+ */
+
+bool GreaterThan::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	LessOrEqual::isBoolean (accessor)
+ *
+ * Description:	Return true since a comparison is always zero or one.
+ */
+
+bool LessOrEqual::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	GreaterOrEqual::isBoolean (accessor)
+ *
+ * Description:	Return true since a comparison is always zero or one.
+ */
+
+bool GreaterOrEqual::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	Equal::isBoolean (accessor)
+ *
+ * Description:	Return true since a comparison is always zero or one.
+ */
+
+bool Equal::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	NotEqual::isBoolean (accessor)
+ *
+ * Description:	Return true since a comparison is always zero or one.
+ */
+
+bool NotEqual::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	LogicalAnd::isBoolean (accessor)
+ *
+ * Description:	Return true since a logical-and expression is always zero or one.
+ */
+
+bool LogicalAnd::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	LogicalOr::isBoolean (accessor)
+ *
+ * Description:	Return true since a logical-or expression is always zero or one.
+ */
+
+bool LogicalOr::isBoolean() const
+{
+    return true;
+}
+
+
+/*
+ * Function:	Expression::isIdentifier (accessor)
+ *
+ * Description:	Return false since most expressions are not identifiers.
+ */
+
+bool Expression::isIdentifier(const Symbol *&symbol) const
+{
+    return false;
+}
+
+
+/*
+ * Function:	Identifier::isIdentifier (accessor)
+ *
+ * Description:	Return true since an identifier is in fact an identifier.
+ */
+
+bool Identifier::isIdentifier(const Symbol *&symbol) const
+{
+    symbol = _symbol;
+    return true;
+}
@@ -17,10 +17,15 @@
  *		doesn't necessarily mesh well with a tree designed using
  *		object-orientation.  So, here is my compromise:
  *
+ *		Nodes are allocated from the current arena, if there is
+ *		one, and are freed when the arena is reset rather than
+ *		being deleted individually.
+ *
  *		Tree.h - class definitions
  *		Tree.cpp - constructors and accessors
  *		allocator.cpp - member functions to do storage allocation
  *		generator.cpp - member functions to do code generation
+ *		lowerer.cpp - member functions to translate into the IR
  *		writer.cpp - member functions to write the tree to a stream
  */
 
@@ -32,6 +37,8 @@
 # include "Scope.h"
 # include "Register.h"
 # include "Label.h"
+# include "Arena.h"
+# include "IR.h"
 
 typedef std::vector<class Statement *> Statements;
 typedef std::vector<class Expression *> Expressions;
@@ -47,8 +54,11 @@ protected:
 
 public:
     virtual ~Node() {}
+    void *operator new(size_t size) { return Arena::obtain(size); }
+    void operator delete(void *object) {}
     virtual void write(ostream &ostr) const = 0;
     virtual void allocate(int &offset) const {}
+    virtual void scan() const {}
     virtual void generate() {}
 };
 
@@ -58,6 +68,9 @@ public:
 class Statement : public Node {
 protected:
     Statement() {}
+
+public:
+    virtual void lower() {}
 };
 
 
@@ -71,6 +84,8 @@ protected:
 
 public:
     int _offset;
+    unsigned _use;
+    unsigned _need;
     bool _hasCall;
     Register *_register;
 
@@ -79,8 +94,18 @@ public:
 
     virtual void operand(ostream &ostr) const;
     virtual bool isDereference(Expression *&pointer) const;
+    virtual bool isAddress(Expression *&expr) const;
+    virtual bool isAdd(Expression *&left, Expression *&right) const;
+    virtual bool isSubtract(Expression *&left, Expression *&right) const;
+    virtual bool isMultiply(Expression *&left, Expression *&right) const;
     virtual bool isNumber(unsigned &value) const;
+    virtual bool isBoolean() const;
+    virtual bool isIdentifier(const Symbol *&symbol) const;
     virtual void test(const Label &label, bool ifTrue);
+
+    virtual Temp lower();
+    virtual Temp lowerAddress();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -90,6 +115,10 @@ class Binary : public Expression {
 protected:
     Expression *_left, *_right;
     Binary(Expression *left, Expression *right, const Type &type);
+
+public:
+    static bool rightFirst(const Expression *left, const Expression *right);
+    virtual void scan() const;
 };
 
 
@@ -99,6 +128,9 @@ class Unary : public Expression {
 protected:
     Expression *_expr;
     Unary(Expression *expr, const Type &type);
+
+public:
+    virtual void scan() const;
 };
 
 
@@ -112,6 +144,8 @@ public:
     const string &value() const;
     virtual void write(ostream &ostr) const;
     virtual void operand(ostream &ostr) const;
+    virtual Temp lower();
+    virtual Temp lowerAddress();
 };
 
 
@@ -125,6 +159,10 @@ public:
     const Symbol *symbol() const;
     virtual void write(ostream &ostr) const;
     virtual void operand(ostream &ostr) const;
+    virtual void scan() const;
+    virtual bool isIdentifier(const Symbol *&symbol) const;
+    virtual Temp lower();
+    virtual Temp lowerAddress();
 };
 
 
@@ -140,6 +178,9 @@ public:
     virtual void write(ostream &ostr) const;
     virtual void operand(ostream &ostr) const;
     virtual bool isNumber(unsigned &value) const;
+    virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -152,7 +193,9 @@ class Call : public Expression {
 public:
     Call(const Symbol *id, const Expressions &args, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -162,8 +205,11 @@ class Not : public Unary {
 public:
     Not(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
     virtual void generate();
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -174,6 +220,7 @@ public:
     Negate(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -185,6 +232,8 @@ public:
     virtual bool isDereference(Expression *&pointer) const;
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Temp lower();
+    virtual Temp lowerAddress();
 };
 
 
@@ -193,8 +242,12 @@ public:
 class Address : public Unary {
 public:
     Address(Expression *expr, const Type &type);
+    virtual bool isAddress(Expression *&expr) const;
     virtual void write(ostream &ostr) const;
+    virtual void operand(ostream &ostr) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -205,6 +258,7 @@ public:
     Cast(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -213,8 +267,10 @@ public:
 class Multiply : public Binary {
 public:
     Multiply(Expression *left, Expression *right, const Type &type);
+    virtual bool isMultiply(Expression *&left, Expression *&right) const;
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -225,6 +281,7 @@ public:
     Divide(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -235,6 +292,7 @@ public:
     Remainder(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -243,8 +301,10 @@ public:
 class Add : public Binary {
 public:
     Add(Expression *left, Expression *right, const Type &type);
+    virtual bool isAdd(Expression *&left, Expression *&right) const;
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -253,8 +313,10 @@ public:
 class Subtract : public Binary {
 public:
     Subtract(Expression *left, Expression *right, const Type &type);
+    virtual bool isSubtract(Expression *&left, Expression *&right) const;
     virtual void write(ostream &ostr) const;
     virtual void generate();
+    virtual Temp lower();
 };
 
 
@@ -264,7 +326,10 @@ class LessThan : public Binary {
 public:
     LessThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -274,7 +339,10 @@ class GreaterThan : public Binary {
 public:
     GreaterThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -284,7 +352,10 @@ class LessOrEqual : public Binary {
 public:
     LessOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -294,7 +365,10 @@ class GreaterOrEqual : public Binary {
 public:
     GreaterOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -304,7 +378,10 @@ class Equal : public Binary {
 public:
     Equal(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -314,7 +391,10 @@ class NotEqual : public Binary {
 public:
     NotEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -324,7 +404,11 @@ class LogicalAnd: public Binary {
 public:
     LogicalAnd(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
+    virtual void scan() const;
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -334,7 +418,11 @@ class LogicalOr : public Binary {
 public:
     LogicalOr(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
+    virtual bool isBoolean() const;
+    virtual void scan() const;
     virtual void test(const Label &label, bool ifTrue);
+    virtual Temp lower();
+    virtual void lowerTest(const Label &label, bool ifTrue);
 };
 
 
@@ -346,7 +434,9 @@ class Assignment : public Statement {
 public:
     Assignment(Expression *left, Expression *right);
     virtual void write(ostream &ostr) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual void lower();
 };
 
 
@@ -358,7 +448,9 @@ class Return : public Statement {
 public:
     Return(Expression *expr);
     virtual void write(ostream &ostr) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual void lower();
 };
 
 
@@ -373,7 +465,9 @@ public:
     Scope *declarations() const;
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual void lower();
 };
 
 
@@ -387,7 +481,9 @@ public:
     While(Expression *expr, Statement *stmt);
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual void lower();
 };
 
 
@@ -403,7 +499,9 @@ public:
     For(Statement *init, Expression *expr, Statement *incr, Statement *stmt);
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual void lower();
 };
 
 
@@ -417,7 +515,9 @@ public:
     If(Expression *expr, Statement *thenStmt, Statement *elseStmt);
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual void lower();
 };
 
 
@@ -429,7 +529,9 @@ class Simple : public Statement {
 public:
     Simple(Expression *expr);
     virtual void write(ostream &ostr) const;
+    virtual void scan() const;
     virtual void generate();
+    virtual void lower();
 };
 
 
@@ -443,7 +545,9 @@ public:
     Function(const Symbol *id, Block *body);
     virtual void write(ostream &ostr) const;
     virtual void allocate(int &offset) const;
+    std::vector<Register *> allocate(const std::vector<Register *> &registers) const;
     virtual void generate();
+    Procedure *lower();
 };
 
 # endif /* TREE_H */
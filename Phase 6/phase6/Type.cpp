@@ -17,17 +17,206 @@
  *		- predicate functions such as isArray()
  *		- stream operator
  *		- the error type
+ *		- hash-consing of types
  */
 
+# include <vector>
 # include <cassert>
 # include "tokens.h"
 # include "Type.h"
 
 using namespace std;
 
+struct Type::Entry {
+    Kind kind;
+    int specifier;
+    unsigned indirection;
+    unsigned length;
+    Parameters *parameters;
+    unsigned promoted, dereferenced, result;
+};
+
+Type::Entry *Type::_table = nullptr;
 static Type voidPtr(VOID, 1);
 
 
+/*
+ * Function:	Type::entries (private)
+ *
+ * Description:	Return the table of distinct types.  The table is created
+ *		on first use, since types are constructed during static
+ *		initialization in other files.  Entry zero is the error
+ *		type, so that a default type is always valid.
+ *
+ *		We also keep a plain pointer to the entries, which is
+ *		updated whenever the table grows, so that looking up an
+ *		entry doesn't need to check whether the table exists yet.
+ *		The voidPtr type above guarantees it does before main.
+ */
+
+vector<Type::Entry> &Type::entries()
+{
+    static vector<Entry> table(1, Entry {ERROR, 0, 0, 0, nullptr, 0, 0, 0});
+
+    _table = table.data();
+    return table;
+}
+
+
+/*
+ * Function:	Type::entry (private)
+ *
+ * Description:	Return the table entry for this type.
+ */
+
+const Type::Entry &Type::entry() const
+{
+    return _table[_handle];
+}
+
+
+/*
+ * Function:	Type::hash (private)
+ *
+ * Description:	Return the FNV-1a hash of the fields of the given type,
+ *		including the handles of its parameters, if any.
+ */
+
+unsigned Type::hash(const Entry &e)
+{
+    unsigned h = 2166136261u;
+
+    h = (h ^ e.kind) * 16777619u;
+    h = (h ^ e.specifier) * 16777619u;
+    h = (h ^ e.indirection) * 16777619u;
+    h = (h ^ e.length) * 16777619u;
+    h = (h ^ (e.parameters != nullptr)) * 16777619u;
+
+    if (e.parameters != nullptr)
+	for (auto &param : *e.parameters)
+	    h = (h ^ param._handle) * 16777619u;
+
+    return h;
+}
+
+
+/*
+ * Function:	Type::same (private)
+ *
+ * Description:	Return whether two entries describe exactly the same type.
+ *		Unlike equality, an unspecified parameter list only matches
+ *		another unspecified parameter list.
+ */
+
+bool Type::same(const Entry &a, const Entry &b)
+{
+    if (a.kind != b.kind || a.specifier != b.specifier)
+	return false;
+
+    if (a.indirection != b.indirection || a.length != b.length)
+	return false;
+
+    if (!a.parameters || !b.parameters)
+	return !a.parameters && !b.parameters;
+
+    if (a.parameters->size() != b.parameters->size())
+	return false;
+
+    for (unsigned i = 0; i < a.parameters->size(); i ++)
+	if ((*a.parameters)[i]._handle != (*b.parameters)[i]._handle)
+	    return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	Type::intern (private)
+ *
+ * Description:	Return the handle of the given type, adding it to the
+ *		table if we haven't seen it before.  Types are found using
+ *		an open-addressing hash table of handles, just as atoms
+ *		are.  Since parameter lists are interned along with their
+ *		function types, a duplicate list is deleted.  The results
+ *		of promote() and deref() are computed once here so that
+ *		later calls are just lookups.
+ */
+
+unsigned Type::intern(Entry &e)
+{
+    static vector<unsigned> index(64);
+    unsigned mask = index.size() - 1, i = hash(e) & mask;
+    unsigned handle, promoted, dereferenced, result;
+
+
+    while ((handle = index[i]) != 0) {
+	if (same(entries()[handle], e)) {
+	    delete e.parameters;
+	    return handle;
+	}
+
+	i = (i + 1) & mask;
+    }
+
+    handle = index[i] = entries().size();
+    e.promoted = e.dereferenced = e.result = handle;
+    entries().push_back(e);
+    _table = entries().data();
+
+    if (entries().size() * 2 > index.size()) {
+	vector<unsigned> old(index.size() * 2);
+
+	index.swap(old);
+	mask = index.size() - 1;
+
+	for (unsigned h = 1; h < entries().size(); h ++) {
+	    i = hash(entries()[h]) & mask;
+
+	    while (index[i] != 0)
+		i = (i + 1) & mask;
+
+	    index[i] = h;
+	}
+    }
+
+    if (e.kind == SCALAR && e.indirection == 0 && e.specifier == CHAR)
+	promoted = Type(INT, 0)._handle;
+    else if (e.kind == ARRAY)
+	promoted = Type(e.specifier, e.indirection + 1)._handle;
+    else
+	promoted = handle;
+
+    if (e.kind == SCALAR && e.indirection > 0)
+	dereferenced = Type(e.specifier, e.indirection - 1)._handle;
+    else
+	dereferenced = handle;
+
+    if (e.kind == FUNCTION)
+	result = Type(e.specifier, e.indirection)._handle;
+    else
+	result = handle;
+
+    entries()[handle].promoted = promoted;
+    entries()[handle].dereferenced = dereferenced;
+    entries()[handle].result = result;
+    return handle;
+}
+
+
+/*
+ * Function:	Type::Type (constructor)
+ *
+ * Description:	Initialize this type as the given type.
+ */
+
+Type::Type(Kind kind, int specifier, unsigned indirection, unsigned length,
+	   Parameters *parameters)
+{
+    Entry e {kind, specifier, indirection, length, parameters, 0, 0, 0};
+    _handle = intern(e);
+}
+
+
 /*
  * Function:	Type::Type (constructor)
  *
@@ -35,7 +224,7 @@ static Type voidPtr(VOID, 1);
  */
 
 Type::Type()
-    : _kind(ERROR)
+    : _handle(0)
 {
 }
 
@@ -47,7 +236,7 @@ Type::Type()
  */
 
 Type::Type(int specifier, unsigned indirection)
-    : _specifier(specifier), _indirection(indirection), _kind(SCALAR)
+    : Type(SCALAR, specifier, indirection, 0, nullptr)
 {
 }
 
@@ -59,57 +248,44 @@ Type::Type(int specifier, unsigned indirection)
  */
 
 Type::Type(int specifier, unsigned indirection, unsigned length)
-    : _specifier(specifier), _indirection(indirection), _length(length)
+    : Type(ARRAY, specifier, indirection, length, nullptr)
 {
-    _kind = ARRAY;
 }
 
 
 /*
  * Function:	Type::Type (constructor)
  *
- * Description:	Initialize this type object as a function type.
+ * Description:	Initialize this type object as a function type.  The
+ *		parameter list now belongs to the type table.
  */
 
 Type::Type(int specifier, unsigned indirection, Parameters *parameters)
-    : _specifier(specifier), _indirection(indirection), _parameters(parameters)
+    : Type(FUNCTION, specifier, indirection, 0, parameters)
 {
-    _kind = FUNCTION;
 }
 
 
 /*
  * Function:	Type::operator ==
  *
- * Description:	Return whether another type is equal to this type.  The
- *		parameter lists are checked for function types, which C++
- *		makes so easy.  (At least, it makes something easy!)
+ * Description:	Return whether another type is equal to this type.  Equal
+ *		types have equal handles, with one exception: a function
+ *		type with an unspecified parameter list is equal to any
+ *		function type with the same return type.
  */
 
 bool Type::operator ==(const Type &rhs) const
 {
-    if (_kind != rhs._kind)
-	return false;
-
-    if (_kind == ERROR)
+    if (_handle == rhs._handle)
 	return true;
 
-    if (_specifier != rhs._specifier)
-	return false;
+    const Entry &a = entry(), &b = rhs.entry();
 
-    if (_indirection != rhs._indirection)
+    if (a.kind != FUNCTION || b.kind != FUNCTION || a.result != b.result)
 	return false;
 
-    if (_kind == SCALAR)
-	return true;
-
-    if (_kind == ARRAY)
-	return _length == rhs._length;
-
-    if (!_parameters || !rhs._parameters)
-	return true;
-
-    return *_parameters == *rhs._parameters;
+    return !a.parameters || !b.parameters;
 }
 
 
@@ -135,7 +311,7 @@ bool Type::operator !=(const Type &rhs) const
 
 bool Type::isArray() const
 {
-    return _kind == ARRAY;
+    return entry().kind == ARRAY;
 }
 
 
@@ -147,7 +323,7 @@ bool Type::isArray() const
 
 bool Type::isScalar() const
 {
-    return _kind == SCALAR;
+    return entry().kind == SCALAR;
 }
 
 
@@ -159,7 +335,7 @@ bool Type::isScalar() const
 
 bool Type::isFunction() const
 {
-    return _kind == FUNCTION;
+    return entry().kind == FUNCTION;
 }
 
 
@@ -171,7 +347,7 @@ bool Type::isFunction() const
 
 bool Type::isError() const
 {
-    return _kind == ERROR;
+    return _handle == 0;
 }
 
 
@@ -183,7 +359,7 @@ bool Type::isError() const
 
 int Type::specifier() const
 {
-    return _specifier;
+    return entry().specifier;
 }
 
 
@@ -195,7 +371,7 @@ int Type::specifier() const
 
 unsigned Type::indirection() const
 {
-    return _indirection;
+    return entry().indirection;
 }
 
 
@@ -209,8 +385,8 @@ unsigned Type::indirection() const
 
 unsigned Type::length() const
 {
-    assert(_kind == ARRAY);
-    return _length;
+    assert(entry().kind == ARRAY);
+    return entry().length;
 }
 
 
@@ -223,8 +399,8 @@ unsigned Type::length() const
 
 Parameters *Type::parameters() const
 {
-    assert(_kind == FUNCTION);
-    return _parameters;
+    assert(entry().kind == FUNCTION);
+    return entry().parameters;
 }
 
 
@@ -249,7 +425,8 @@ bool Type::isValue() const
 
 bool Type::isInteger() const
 {
-    return _kind == SCALAR && _specifier != VOID && _indirection == 0;
+    const Entry &e = entry();
+    return e.kind == SCALAR && e.specifier != VOID && e.indirection == 0;
 }
 
 
@@ -262,7 +439,8 @@ bool Type::isInteger() const
 
 bool Type::isPointer() const
 {
-    return (_kind == SCALAR && _indirection > 0) || _kind == ARRAY;
+    const Entry &e = entry();
+    return (e.kind == SCALAR && e.indirection > 0) || e.kind == ARRAY;
 }
 
 
@@ -297,13 +475,10 @@ bool Type::isCompatibleWith(const Type &that) const
 
 Type Type::promote() const
 {
-    if (_kind == SCALAR && _indirection == 0 && _specifier == CHAR)
-	return Type(INT, 0);
+    Type type;
 
-    if (_kind == ARRAY)
-	return Type(_specifier, _indirection + 1);
-
-    return *this;
+    type._handle = entry().promoted;
+    return type;
 }
 
 
@@ -316,8 +491,11 @@ Type Type::promote() const
 
 Type Type::deref() const
 {
-    assert(_kind == SCALAR && _indirection > 0);
-    return Type(_specifier, _indirection - 1);
+    Type type;
+
+    assert(entry().kind == SCALAR && entry().indirection > 0);
+    type._handle = entry().dereferenced;
+    return type;
 }
 
 
@@ -20,6 +20,14 @@
  *		As we've designed them, types are essentially immutable,
  *		since we haven't included any mutators.  In practice, we'll
  *		be creating new types rather than changing existing types.
+ *
+ *		Since they're immutable, types are also hash-consed: each
+ *		distinct type is stored once in a table, and a type object
+ *		is just a 32-bit handle into that table.  Two types with
+ *		the same handle are the same type, so copying a type is
+ *		free and comparing two types is usually an integer
+ *		comparison.  The table owns the parameter lists of function
+ *		types, so they must never be deleted by anyone else.
  */
 
 # ifndef TYPE_H
@@ -30,12 +38,20 @@
 typedef std::vector<class Type> Parameters;
 
 class Type {
-    int _specifier;
-    unsigned _indirection;
-    unsigned _length;
-    Parameters *_parameters;
+    unsigned _handle;
+
+    enum Kind { ARRAY, ERROR, FUNCTION, SCALAR };
+    struct Entry;
+    static Entry *_table;
+
+    Type(Kind kind, int specifier, unsigned indirection, unsigned length,
+	 Parameters *parameters);
 
-    enum { ARRAY, ERROR, FUNCTION, SCALAR } _kind;
+    const Entry &entry() const;
+    static std::vector<Entry> &entries();
+    static unsigned hash(const Entry &entry);
+    static bool same(const Entry &a, const Entry &b);
+    static unsigned intern(Entry &entry);
 
 public:
     Type();
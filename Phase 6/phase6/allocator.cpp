@@ -8,10 +8,26 @@
  *		Extra functionality:
  *		- maintaining minimum offset in nested blocks
  *		- allocation within statements
+ *		- keeping scalar locals in registers
+ *
+ *		Registers are allocated by linear scan.  The statements of
+ *		a function are scanned in the order in which they are
+ *		generated, numbering each use of a variable, and a
+ *		variable is live from its first use to its last.  A
+ *		variable used anywhere within a loop is live for all of
+ *		it, since its value may be carried around to the next
+ *		iteration.  Only int and pointer variables whose address
+ *		is never taken are candidates.
+ *
+ *		The same scan also numbers where the value of each
+ *		expression is used, which is how the generator decides
+ *		which register to spill.
  */
 
 # include <cassert>
 # include <iostream>
+# include <map>
+# include <algorithm>
 # include "checker.h"
 # include "machine.h"
 # include "tokens.h"
@@ -19,6 +35,16 @@
 
 using namespace std;
 
+struct Range {
+    Symbol *symbol;
+    unsigned first, last, weight;
+    bool addressed;
+};
+
+static thread_local vector<Range> ranges;
+static thread_local map<const Symbol *, unsigned> indices;
+static thread_local unsigned position, depth;
+
 
 /*
  * Function:	Type::size
@@ -31,16 +57,16 @@ unsigned Type::size() const
     unsigned count;
 
 
-    assert(_kind != FUNCTION && _kind != ERROR);
-    count = (_kind == ARRAY ? _length : 1);
+    assert(!isFunction() && !isError());
+    count = (isArray() ? length() : 1);
 
-    if (_indirection > 0)
+    if (indirection() > 0)
 	return count * SIZEOF_PTR;
 
-    if (_specifier == INT)
+    if (specifier() == INT)
 	return count * SIZEOF_INT;
 
-    if (_specifier == CHAR)
+    if (specifier() == CHAR)
 	return count * SIZEOF_CHAR;
 
     return 0;
@@ -153,3 +179,398 @@ void Function::allocate(int &offset) const
     offset = 0;
     _body->allocate(offset);
 }
+
+
+/*
+ * Function:	use (private)
+ *
+ * Description:	Note a use of the given symbol at the current position.
+ *		Each use adds to the weight of a variable, ten times more
+ *		for each loop it is in, which is how much keeping it in
+ *		memory would cost.
+ */
+
+static void use(const Symbol *symbol)
+{
+    auto it = indices.find(symbol);
+    unsigned cost = 1;
+
+
+    if (it != indices.end()) {
+	Range &range = ranges[it->second];
+	range.first = min(range.first, position);
+	range.last = max(range.last, position);
+
+	for (unsigned i = 0; i < depth && i < 4; i ++)
+	    cost *= 10;
+
+	range.weight += cost;
+    }
+
+    position ++;
+}
+
+
+/*
+ * Function:	extend (private)
+ *
+ * Description:	Extend any variable used within the loop that started at
+ *		the given position over the whole loop.
+ */
+
+static void extend(unsigned start)
+{
+    for (auto &range : ranges)
+	if (range.first != ~0u && range.last >= start) {
+	    range.first = min(range.first, start);
+	    range.last = position;
+	}
+
+    position ++;
+}
+
+
+/*
+ * Function:	Binary::scan
+ *
+ * Description:	Scan the uses of variables in a binary expression, whose
+ *		operands are both used by the operator once computed.  The
+ *		operands are scanned in the order they are computed.
+ */
+
+void Binary::scan() const
+{
+    if (rightFirst(_left, _right)) {
+	_right->scan();
+	_left->scan();
+    } else {
+	_left->scan();
+	_right->scan();
+    }
+
+    _left->_use = _right->_use = position ++;
+}
+
+
+/*
+ * Function:	LogicalAnd::scan
+ *
+ * Description:	Scan the uses of variables in a logical and expression,
+ *		whose operands are always tested from left to right.
+ */
+
+void LogicalAnd::scan() const
+{
+    _left->scan();
+    _right->scan();
+    _left->_use = _right->_use = position ++;
+}
+
+
+/*
+ * Function:	LogicalOr::scan
+ *
+ * Description:	Scan the uses of variables in a logical or expression,
+ *		whose operands are always tested from left to right.
+ */
+
+void LogicalOr::scan() const
+{
+    _left->scan();
+    _right->scan();
+    _left->_use = _right->_use = position ++;
+}
+
+
+/*
+ * Function:	Unary::scan
+ *
+ * Description:	Scan the uses of variables in a unary expression, whose
+ *		operand is used by the operator once computed.
+ */
+
+void Unary::scan() const
+{
+    _expr->scan();
+    _expr->_use = position ++;
+}
+
+
+/*
+ * Function:	Identifier::scan
+ *
+ * Description:	Note the use of this identifier.
+ */
+
+void Identifier::scan() const
+{
+    use(_symbol);
+}
+
+
+/*
+ * Function:	Call::scan
+ *
+ * Description:	Scan the uses of variables in the arguments of a call,
+ *		which are generated and pushed last to first.
+ */
+
+void Call::scan() const
+{
+    for (int i = _args.size() - 1; i >= 0; i --) {
+	_args[i]->scan();
+	_args[i]->_use = position ++;
+    }
+}
+
+
+/*
+ * Function:	Address::scan
+ *
+ * Description:	Scan the uses of variables in an address expression.  A
+ *		variable whose address is taken must stay in memory.
+ */
+
+void Address::scan() const
+{
+    const Symbol *symbol;
+
+
+    if (_expr->isIdentifier(symbol)) {
+	if (indices.count(symbol) > 0)
+	    ranges[indices[symbol]].addressed = true;
+    } else
+	Unary::scan();
+}
+
+
+/*
+ * Function:	Assignment::scan
+ *
+ * Description:	Scan the uses of variables in an assignment statement.
+ *		The right-hand side is scanned first since it is computed
+ *		before anything is written.
+ */
+
+void Assignment::scan() const
+{
+    _right->scan();
+    _left->scan();
+    _right->_use = position ++;
+}
+
+
+/*
+ * Function:	Return::scan
+ *
+ * Description:	Scan the uses of variables in a return statement.
+ */
+
+void Return::scan() const
+{
+    _expr->scan();
+    _expr->_use = position ++;
+}
+
+
+/*
+ * Function:	Simple::scan
+ *
+ * Description:	Scan the uses of variables in an expression statement.
+ */
+
+void Simple::scan() const
+{
+    _expr->scan();
+    _expr->_use = position ++;
+}
+
+
+/*
+ * Function:	Block::scan
+ *
+ * Description:	Scan the uses of variables in this block, after noting
+ *		the variables declared within it as candidates.
+ */
+
+void Block::scan() const
+{
+    const Symbols &symbols = _decls->symbols();
+
+
+    for (auto symbol : symbols) {
+	indices[symbol] = ranges.size();
+	ranges.push_back(Range {symbol, ~0u, 0, 0, false});
+	symbol->_register = nullptr;
+    }
+
+    for (auto stmt : _stmts)
+	stmt->scan();
+}
+
+
+/*
+ * Function:	While::scan
+ *
+ * Description:	Scan the uses of variables in a while loop.
+ */
+
+void While::scan() const
+{
+    unsigned start = position;
+
+
+    depth ++;
+    _expr->scan();
+    _expr->_use = position ++;
+    _stmt->scan();
+    depth --;
+    extend(start);
+}
+
+
+/*
+ * Function:	For::scan
+ *
+ * Description:	Scan the uses of variables in a for loop.
+ */
+
+void For::scan() const
+{
+    unsigned start;
+
+
+    _init->scan();
+    start = position;
+    depth ++;
+    _expr->scan();
+    _expr->_use = position ++;
+    _stmt->scan();
+    _incr->scan();
+    depth --;
+    extend(start);
+}
+
+
+/*
+ * Function:	If::scan
+ *
+ * Description:	Scan the uses of variables in an if-then or if-then-else
+ *		statement.
+ */
+
+void If::scan() const
+{
+    _expr->scan();
+    _expr->_use = position ++;
+    _thenStmt->scan();
+
+    if (_elseStmt != nullptr)
+	_elseStmt->scan();
+}
+
+
+/*
+ * Function:	Function::allocate
+ *
+ * Description:	Allocate the given registers to the variables of this
+ *		function, and return those that were used.  When no
+ *		register is free, whichever variable weighs least is left
+ *		in memory, preferring the one that is live longest if they
+ *		weigh the same.  Variables declared with register are
+ *		always preferred over those that were not.  The
+ *		parameters are live from the start, since they arrive in
+ *		memory and must first be loaded.
+ */
+
+vector<Register *> Function::allocate(const vector<Register *> &registers) const
+{
+    Parameters *params = _id->type().parameters();
+    vector<Range *> candidates, active;
+    vector<Register *> used;
+
+
+    /* Scan the function and find the candidates. */
+
+    ranges.clear();
+    indices.clear();
+    position = 1;
+    depth = 0;
+    _body->scan();
+
+    for (unsigned i = 0; i < params->size(); i ++)
+	if (ranges[i].first != ~0u)
+	    ranges[i].first = 0;
+
+    for (auto &range : ranges) {
+	const Type &type = range.symbol->type();
+
+	if (range.first != ~0u && !range.addressed && !type.isArray()
+		&& type.size() == SIZEOF_REG) {
+	    if (range.symbol->_hint)
+		range.weight += 100000;
+
+	    candidates.push_back(&range);
+	}
+    }
+
+    stable_sort(candidates.begin(), candidates.end(),
+		[](const Range *a, const Range *b) { return a->first < b->first; });
+
+
+    /* Assign the registers by linear scan. */
+
+    for (auto current : candidates) {
+	Register *reg = nullptr;
+
+	for (unsigned i = 0; i < active.size(); )
+	    if (active[i]->last < current->first)
+		active.erase(active.begin() + i);
+	    else
+		i ++;
+
+	for (auto candidate : registers) {
+	    bool free = true;
+
+	    for (auto other : active)
+		if (other->symbol->_register == candidate)
+		    free = false;
+
+	    if (free) {
+		reg = candidate;
+		break;
+	    }
+	}
+
+	if (reg == nullptr) {
+	    Range *victim = current;
+
+	    for (auto other : active)
+		if (other->weight < victim->weight || (other->weight ==
+			victim->weight && other->last > victim->last))
+		    victim = other;
+
+	    if (victim != current) {
+		reg = victim->symbol->_register;
+		victim->symbol->_register = nullptr;
+		active.erase(find(active.begin(), active.end(), victim));
+	    }
+	}
+
+	if (reg != nullptr) {
+	    current->symbol->_register = reg;
+	    active.push_back(current);
+	}
+    }
+
+    for (auto reg : registers)
+	for (auto range : candidates)
+	    if (range->symbol->_register == reg) {
+		used.push_back(reg);
+		break;
+	    }
+
+    ranges.clear();
+    indices.clear();
+    return used;
+}
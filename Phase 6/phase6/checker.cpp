@@ -7,12 +7,30 @@
  *		If a symbol is redeclared, the redeclaration is discarded
  *		and the original declaration is retained.
  *
+ *		Rather than searching each enclosing scope in turn, we keep
+ *		a single table, indexed by atom, of the innermost visible
+ *		symbol with each name declared in a nested scope.  When a
+ *		declaration shadows another, the shadowed symbol is pushed
+ *		on an undo log, which is popped back when its scope is
+ *		closed.  Global symbols are not in the table; they are
+ *		found directly in the outermost scope, which is hashed.  So
+ *		looking up a name costs the same at any nesting depth.
+ *
+ *		Trees, symbols, and scopes are allocated from the arena of
+ *		the function being compiled, which is reset once it has
+ *		been generated.  Symbols in the outermost scope must
+ *		outlive that arena, so they are always allocated with ::new.
+ *
  *		Extra functionality:
  *		- inserting an undeclared symbol with the error type
  *		- scaling the operands and results of pointer arithmetic
  *		- explicit type promotions
+ *		- constant-time lookup at any nesting depth
+ *		- folding constants and simplifying identities, and
+ *		  dropping statements whose tests are constant
  */
 
+# include <climits>
 # include <iostream>
 # include "lexer.h"
 # include "checker.h"
@@ -25,6 +43,9 @@
 using namespace std;
 
 static Scope *outermost, *toplevel;
+static vector<Symbol *> visible;
+static vector<pair<Atom, Symbol *>> shadowed;
+static vector<unsigned> marks;
 static const Type error, integer(INT), character(CHAR), voidptr(VOID, 1);
 
 static string redefined = "redefinition of '%s'";
@@ -65,7 +86,8 @@ static Type promote(Expression *&expr)
 /*
  * Function:	scale
  *
- * Description:	Scale the result of pointer arithmetic.
+ * Description:	Scale the result of pointer arithmetic.  A constant
+ *		is simply replaced; the old one is freed with the arena.
  */
 
 static Expression *scale(Expression *expr, unsigned size)
@@ -73,15 +95,170 @@ static Expression *scale(Expression *expr, unsigned size)
     unsigned value;
 
 
-    if (expr->isNumber(value)) {
-	delete expr;
+    if (expr->isNumber(value))
 	return new Number(value * size);
-    }
 
     return new Multiply(expr, new Number(size), integer);
 }
 
 
+/*
+ * Function:	constant
+ *
+ * Description:	Return whether an expression is a number, along with its
+ *		value as an int.
+ */
+
+static bool constant(Expression *expr, int &value)
+{
+    unsigned number;
+
+
+    if (!expr->isNumber(number))
+	return false;
+
+    value = number;
+    return true;
+}
+
+
+/*
+ * Function:	fold
+ *
+ * Description:	Fold a binary operator whose operands are both numbers into
+ *		a number, or simplify it if one operand is an identity for
+ *		the operator, and return null if neither is possible.  As
+ *		with 32-bit ints at run time, addition, subtraction, and
+ *		multiplication wrap around.  A division by zero, or of the
+ *		most negative int by minus one, is not folded, so that it
+ *		still traps at run time.  An operand is dropped only if it
+ *		has no call, and is never simplified to an lvalue, so that
+ *		x + 0 is still not assignable.
+ */
+
+static Expression *fold(int op, Expression *left, Expression *right,
+			const Type &result)
+{
+    int x, y;
+    unsigned a, b;
+
+
+    if (result == error)
+	return nullptr;
+
+    if (constant(left, x) && constant(right, y)) {
+	a = x;
+	b = y;
+
+	switch (op) {
+	case PLUS: return new Number(a + b);
+	case MINUS: return new Number(a - b);
+	case STAR: return new Number(a * b);
+	case LTN: return new Number(x < y);
+	case GTN: return new Number(x > y);
+	case LEQ: return new Number(x <= y);
+	case GEQ: return new Number(x >= y);
+	case EQL: return new Number(x == y);
+	case NEQ: return new Number(x != y);
+
+	case DIV:
+	case REM:
+	    if (y == 0 || (x == INT_MIN && y == -1))
+		return nullptr;
+
+	    return new Number(op == DIV ? x / y : x % y);
+	}
+    }
+
+    if (constant(right, y)) {
+	if ((op == PLUS || op == MINUS || op == STAR || op == DIV) &&
+		y == (op == STAR || op == DIV ? 1 : 0) && !left->lvalue())
+	    return left;
+
+	if (((op == STAR && y == 0) || (op == REM && (y == 1 || y == -1))) &&
+		!left->_hasCall)
+	    return new Number(0);
+    }
+
+    if (constant(left, x)) {
+	if (((op == PLUS && x == 0) || (op == STAR && x == 1)) &&
+		!right->lvalue() && right->type() == result)
+	    return right;
+
+	if (op == STAR && x == 0 && !right->_hasCall)
+	    return new Number(0);
+    }
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	truth
+ *
+ * Description:	Return an expression whose value is one if the given
+ *		expression is nonzero, and zero otherwise.  An expression
+ *		that is already zero or one, such as a comparison, is
+ *		returned unchanged.
+ */
+
+static Expression *truth(Expression *expr)
+{
+    int value;
+
+
+    if (constant(expr, value))
+	return new Number(value != 0);
+
+    if (expr->isBoolean())
+	return expr;
+
+    return new NotEqual(expr, new Number(0), integer);
+}
+
+
+/*
+ * Function:	lookup
+ *
+ * Description:	Find and return the nearest symbol with the given name.
+ *		If no such symbol is found, return a null pointer.
+ */
+
+static Symbol *lookup(const Atom &name)
+{
+    if (name.id() < visible.size() && visible[name.id()] != nullptr)
+	return visible[name.id()];
+
+    return outermost->find(name);
+}
+
+
+/*
+ * Function:	bind
+ *
+ * Description:	Insert the given symbol into the top-level scope.  If the
+ *		top-level scope is nested, the symbol also becomes the
+ *		visible symbol with its name, and whatever it shadows is
+ *		saved in the undo log.
+ */
+
+static void bind(Symbol *symbol)
+{
+    unsigned id = symbol->name().id();
+
+
+    toplevel->insert(symbol);
+
+    if (toplevel != outermost) {
+	if (id >= visible.size())
+	    visible.resize(2 * id + 1);
+
+	shadowed.push_back(make_pair(symbol->name(), visible[id]));
+	visible[id] = symbol;
+    }
+}
+
+
 /*
  * Function:	openScope
  *
@@ -95,6 +272,7 @@ Scope *openScope()
     if (outermost == nullptr)
 	outermost = toplevel;
 
+    marks.push_back(shadowed.size());
     return toplevel;
 }
 
@@ -103,12 +281,21 @@ Scope *openScope()
  * Function:	closeScope
  *
  * Description:	Remove the top-level scope, and make its enclosing scope
- *		the new top-level scope.
+ *		the new top-level scope.  Any symbols that were shadowed by
+ *		its declarations become visible again.
  */
 
 Scope *closeScope()
 {
     Scope *old = toplevel;
+
+
+    while (shadowed.size() > marks.back()) {
+	visible[shadowed.back().first.id()] = shadowed.back().second;
+	shadowed.pop_back();
+    }
+
+    marks.pop_back();
     toplevel = toplevel->enclosing();
     return old;
 }
@@ -120,26 +307,25 @@ Scope *closeScope()
  * Description:	Define a function with the specified NAME and TYPE.  A
  *		function is always defined in the outermost scope.  This
  *		definition always replaces any previous definition or
- *		declaration.
+ *		declaration.  The old symbol isn't deleted, since calls to
+ *		it may be waiting to be generated.
  */
 
-Symbol *defineFunction(const string &name, const Type &type)
+Symbol *defineFunction(const Atom &name, const Type &type)
 {
     Symbol *symbol = outermost->find(name);
 
     if (symbol != nullptr) {
-	if (symbol->type().isFunction() && symbol->type().parameters()) {
-	    report(redefined, name);
-	    delete symbol->type().parameters();
+	if (symbol->type().isFunction() && symbol->type().parameters())
+	    report(redefined, name.str());
 
-	} else if (type != symbol->type())
-	    report(conflicting, name);
+	else if (type != symbol->type())
+	    report(conflicting, name.str());
 
 	outermost->remove(name);
-	delete symbol;
     }
 
-    symbol = new Symbol(name, type);
+    symbol = ::new Symbol(name, type);
     outermost->insert(symbol);
     return symbol;
 }
@@ -153,20 +339,16 @@ Symbol *defineFunction(const string &name, const Type &type)
  *		redeclaration is discarded.
  */
 
-Symbol *declareFunction(const string &name, const Type &type)
+Symbol *declareFunction(const Atom &name, const Type &type)
 {
     Symbol *symbol = outermost->find(name);
 
     if (symbol == nullptr) {
-	symbol = new Symbol(name, type);
+	symbol = ::new Symbol(name, type);
 	outermost->insert(symbol);
 
-    } else if (type != symbol->type()) {
-	report(conflicting, name);
-	delete type.parameters();
-
-    } else
-	delete type.parameters();
+    } else if (type != symbol->type())
+	report(conflicting, name.str());
 
     return symbol;
 }
@@ -179,22 +361,26 @@ Symbol *declareFunction(const string &name, const Type &type)
  *		redeclaration is discarded.
  */
 
-Symbol *declareVariable(const string &name, const Type &type)
+Symbol *declareVariable(const Atom &name, const Type &type)
 {
     Symbol *symbol = toplevel->find(name);
 
     if (symbol == nullptr) {
 	if (type.specifier() == VOID && type.indirection() == 0)
-	    report(void_object, name);
+	    report(void_object, name.str());
+
+	if (toplevel == outermost)
+	    symbol = ::new Symbol(name, type);
+	else
+	    symbol = new Symbol(name, type);
 
-	symbol = new Symbol(name, type);
-	toplevel->insert(symbol);
+	bind(symbol);
 
     } else if (outermost != toplevel)
-	report(redeclared, name);
+	report(redeclared, name.str());
 
     else if (type != symbol->type())
-	report(conflicting, name);
+	report(conflicting, name.str());
 
     return symbol;
 }
@@ -208,14 +394,14 @@ Symbol *declareVariable(const string &name, const Type &type)
  *		future error messages.
  */
 
-Symbol *checkIdentifier(const string &name)
+Symbol *checkIdentifier(const Atom &name)
 {
-    Symbol *symbol = toplevel->lookup(name);
+    Symbol *symbol = lookup(name);
 
     if (symbol == nullptr) {
-	report(undeclared, name);
+	report(undeclared, name.str());
 	symbol = new Symbol(name, error);
-	toplevel->insert(symbol);
+	bind(symbol);
     }
 
     return symbol;
@@ -311,6 +497,7 @@ Expression *checkNot(Expression *expr)
 {
     const Type &t = promote(expr);
     Type result = error;
+    int value;
 
 
     if (t != error) {
@@ -320,6 +507,9 @@ Expression *checkNot(Expression *expr)
 	    report(invalid_operand, "!");
     }
 
+    if (result != error && constant(expr, value))
+	return new Number(value == 0);
+
     return new Not(expr, result);
 }
 
@@ -335,6 +525,7 @@ Expression *checkNegate(Expression *expr)
 {
     const Type &t = promote(expr);
     Type result = error;
+    int value;
 
 
     if (t != error) {
@@ -344,6 +535,9 @@ Expression *checkNegate(Expression *expr)
 	    report(invalid_operand, "-");
     }
 
+    if (result != error && constant(expr, value))
+	return new Number(-(unsigned) value);
+
     return new Negate(expr, result);
 }
 
@@ -453,7 +647,9 @@ Type checkMultiplicative(Expression *&left, Expression *&right, const string &op
 Expression *checkMultiply(Expression *left, Expression *right)
 {
     Type t = checkMultiplicative(left, right, "*");
-    return new Multiply(left, right, t);
+    Expression *expr = fold(STAR, left, right, t);
+
+    return expr != nullptr ? expr : new Multiply(left, right, t);
 }
 
 
@@ -466,7 +662,9 @@ Expression *checkMultiply(Expression *left, Expression *right)
 Expression *checkDivide(Expression *left, Expression *right)
 {
     Type t = checkMultiplicative(left, right, "/");
-    return new Divide(left, right, t);
+    Expression *expr = fold(DIV, left, right, t);
+
+    return expr != nullptr ? expr : new Divide(left, right, t);
 }
 
 /*
@@ -478,7 +676,9 @@ Expression *checkDivide(Expression *left, Expression *right)
 Expression *checkRemainder(Expression *left, Expression *right)
 {
     Type t = checkMultiplicative(left, right, "%");
-    return new Remainder(left, right, t);
+    Expression *expr = fold(REM, left, right, t);
+
+    return expr != nullptr ? expr : new Remainder(left, right, t);
 }
 
 
@@ -492,6 +692,7 @@ Expression *checkRemainder(Expression *left, Expression *right)
 
 Expression *checkAdd(Expression *left, Expression *right)
 {
+    Expression *expr;
     const Type &t1 = promote(left);
     const Type &t2 = promote(right);
     Type result = error;
@@ -513,6 +714,9 @@ Expression *checkAdd(Expression *left, Expression *right)
 	    report(invalid_operands, "+");
     }
 
+    if ((expr = fold(PLUS, left, right, result)) != nullptr)
+	return expr;
+
     return new Add(left, right, result);
 }
 
@@ -551,7 +755,10 @@ Expression *checkSubtract(Expression *left, Expression *right)
 	    report(invalid_operands, "-");
     }
 
-    tree = new Subtract(left, right, result);
+    if (t1.isPointer() && t1 == t2)
+	tree = new Subtract(left, right, result);
+    else if ((tree = fold(MINUS, left, right, result)) == nullptr)
+	tree = new Subtract(left, right, result);
 
     if (t1.isPointer() && t1 == t2)
 	tree = new Divide(tree, new Number(t1.deref().size()), integer);
@@ -596,7 +803,9 @@ Type checkRelational(Expression *&left, Expression *&right, const string &op)
 Expression *checkLessThan(Expression *left, Expression *right)
 {
     Type t = checkRelational(left, right, "<");
-    return new LessThan(left, right, t);
+    Expression *expr = fold(LTN, left, right, t);
+
+    return expr != nullptr ? expr : new LessThan(left, right, t);
 }
 
 
@@ -609,7 +818,9 @@ Expression *checkLessThan(Expression *left, Expression *right)
 Expression *checkGreaterThan(Expression *left, Expression *right)
 {
     Type t = checkRelational(left, right, ">");
-    return new GreaterThan(left, right, t);
+    Expression *expr = fold(GTN, left, right, t);
+
+    return expr != nullptr ? expr : new GreaterThan(left, right, t);
 }
 
 
@@ -622,7 +833,9 @@ Expression *checkGreaterThan(Expression *left, Expression *right)
 Expression *checkLessOrEqual(Expression *left, Expression *right)
 {
     Type t = checkRelational(left, right, "<=");
-    return new LessOrEqual(left, right, t);
+    Expression *expr = fold(LEQ, left, right, t);
+
+    return expr != nullptr ? expr : new LessOrEqual(left, right, t);
 }
 
 
@@ -635,7 +848,9 @@ Expression *checkLessOrEqual(Expression *left, Expression *right)
 Expression *checkGreaterOrEqual(Expression *left, Expression *right)
 {
     Type t = checkRelational(left, right, ">=");
-    return new GreaterOrEqual(left, right, t);
+    Expression *expr = fold(GEQ, left, right, t);
+
+    return expr != nullptr ? expr : new GreaterOrEqual(left, right, t);
 }
 
 
@@ -674,7 +889,9 @@ Type checkEquality(Expression *&left, Expression *&right, const string &op)
 Expression *checkEqual(Expression *left, Expression *right)
 {
     Type t = checkEquality(left, right, "==");
-    return new Equal(left, right, t);
+    Expression *expr = fold(EQL, left, right, t);
+
+    return expr != nullptr ? expr : new Equal(left, right, t);
 }
 
 
@@ -687,7 +904,9 @@ Expression *checkEqual(Expression *left, Expression *right)
 Expression *checkNotEqual(Expression *left, Expression *right)
 {
     Type t = checkEquality(left, right, "!=");
-    return new NotEqual(left, right, t);
+    Expression *expr = fold(NEQ, left, right, t);
+
+    return expr != nullptr ? expr : new NotEqual(left, right, t);
 }
 
 
@@ -721,12 +940,32 @@ Type checkLogical(Expression *&left, Expression *&right, const string &op)
 /*
  * Function:	checkLogicalAnd
  *
- * Description:	Check a logical-and expression: left && right.
+ * Description:	Check a logical-and expression: left && right.  If the
+ *		left operand is a constant, the right operand is either
+ *		never evaluated or all that matters.  If the right operand
+ *		is a constant, only the truth of the left operand matters,
+ *		or nothing does if the left operand has no call.
  */
 
 Expression *checkLogicalAnd(Expression *left, Expression *right)
 {
     Type t = checkLogical(left, right, "&&");
+    int value;
+
+
+    if (t != error) {
+	if (constant(left, value))
+	    return value == 0 ? new Number(0) : truth(right);
+
+	if (constant(right, value)) {
+	    if (value != 0)
+		return truth(left);
+
+	    if (!left->_hasCall)
+		return new Number(0);
+	}
+    }
+
     return new LogicalAnd(left, right, t);
 }
 
@@ -734,12 +973,29 @@ Expression *checkLogicalAnd(Expression *left, Expression *right)
 /*
  * Function:	checkLogicalOr
  *
- * Description:	Check a logical-or expression: left || right.
+ * Description:	Check a logical-or expression: left || right, which is
+ *		folded just like a logical-and expression.
  */
 
 Expression *checkLogicalOr(Expression *left, Expression *right)
 {
     Type t = checkLogical(left, right, "||");
+    int value;
+
+
+    if (t != error) {
+	if (constant(left, value))
+	    return value != 0 ? new Number(1) : truth(right);
+
+	if (constant(right, value)) {
+	    if (value == 0)
+		return truth(left);
+
+	    if (!left->_hasCall)
+		return new Number(1);
+	}
+    }
+
     return new LogicalOr(left, right, t);
 }
 
@@ -801,3 +1057,79 @@ void checkTest(Expression *&expr)
     if (t != error && !t.isValue())
 	report(invalid_test);
 }
+
+
+/*
+ * Function:	empty
+ *
+ * Description:	Return a statement that does nothing.
+ */
+
+static Statement *empty()
+{
+    return new Block(new Scope(nullptr), Statements());
+}
+
+
+/*
+ * Function:	checkWhile
+ *
+ * Description:	Check a while statement, whose test has already been
+ *		checked.  A loop that is never entered is dropped.
+ */
+
+Statement *checkWhile(Expression *expr, Statement *stmt)
+{
+    int value;
+
+
+    if (constant(expr, value) && value == 0)
+	return empty();
+
+    return new While(expr, stmt);
+}
+
+
+/*
+ * Function:	checkFor
+ *
+ * Description:	Check a for statement, whose test has already been
+ *		checked.  A loop that is never entered is just its
+ *		initialization.
+ */
+
+Statement *checkFor(Statement *init, Expression *expr, Statement *incr,
+		    Statement *stmt)
+{
+    int value;
+
+
+    if (constant(expr, value) && value == 0)
+	return init;
+
+    return new For(init, expr, incr, stmt);
+}
+
+
+/*
+ * Function:	checkIf
+ *
+ * Description:	Check an if statement, whose test has already been checked.
+ *		If the test is a constant, only the statement it selects
+ *		is kept.
+ */
+
+Statement *checkIf(Expression *expr, Statement *thenStmt, Statement *elseStmt)
+{
+    int value;
+
+
+    if (constant(expr, value)) {
+	if (value != 0)
+	    return thenStmt;
+
+	return elseStmt != nullptr ? elseStmt : empty();
+    }
+
+    return new If(expr, thenStmt, elseStmt);
+}
@@ -13,10 +13,10 @@
 Scope *openScope();
 Scope *closeScope();
 
-Symbol *defineFunction(const std::string &name, const Type &type);
-Symbol *declareFunction(const std::string &name, const Type &type);
-Symbol *declareVariable(const std::string &name, const Type &type);
-Symbol *checkIdentifier(const std::string &name);
+Symbol *defineFunction(const Atom &name, const Type &type);
+Symbol *declareFunction(const Atom &name, const Type &type);
+Symbol *declareVariable(const Atom &name, const Type &type);
+Symbol *checkIdentifier(const Atom &name);
 
 Expression *checkCall(Symbol *symbol, Expressions &args);
 Expression *checkArray(Expression *left, Expression *right);
@@ -39,6 +39,10 @@ Expression *checkNotEqual(Expression *left, Expression *right);
 Expression *checkLogicalAnd(Expression *left, Expression *right);
 Expression *checkLogicalOr(Expression *left, Expression *right);
 Statement *checkAssignment(Expression *left, Expression *right);
+Statement *checkWhile(Expression *expr, Statement *stmt);
+Statement *checkFor(Statement *init, Expression *expr, Statement *incr,
+		    Statement *stmt);
+Statement *checkIf(Expression *expr, Statement *thenStmt, Statement *elseStmt);
 
 void checkReturn(Expression *&expr, const Type &type);
 void checkTest(Expression *&expr);
@@ -6,33 +6,87 @@
  *
  *		Extra functionality:
  *		- putting all the global declarations at the end
+ *		- buffering the output rather than flushing every line
+ *		- writing the string literals after each function, so
+ *		  nothing is kept from one function to the next
+ *		- generating functions in parallel
+ *		- keeping scalar locals in %ebx, %esi, and %edi, which are
+ *		  saved and restored only if they are used
+ *		- spilling the register whose value is used furthest in
+ *		  the future, and counting the spills and reloads
+ *		- computing numbers, variables, and the addresses of
+ *		  globals again rather than spilling them
+ *		- reusing the stack slots of spilled values once they are
+ *		  no longer needed
+ *		- computing the operand needing more registers first
+ *		- choosing the cheapest instructions by tiling the tree,
+ *		  so that immediates and memory are used as operands
+ *		  directly, a variable is added to or subtracted from in
+ *		  place, and testl compares against zero
+ *		- addressing array elements with a base, a scaled index,
+ *		  and a displacement in a single operand
+ *		- rotating loops so that the test is at the bottom, and
+ *		  aligning the top of each loop unless optimizing for size
+ *		- optionally translating each function into the IR,
+ *		  optimizing it, and selecting instructions from that
+ *		  instead of the tree
+ *
+ *		Each function is generated into its own buffer, using only
+ *		state that is local to the thread generating it: the
+ *		stream, the offset, the registers, the string literals,
+ *		and the label counter.  The buffers are then copied to the
+ *		output in source order, and since labels are numbered from
+ *		zero within each function, they are renumbered as they are
+ *		copied.  The output is therefore the same no matter how
+ *		many threads are used.
  */
 
 # include <cassert>
+# include <climits>
 # include <iostream>
 # include "generator.h"
 # include "machine.h"
 # include "Tree.h"
 # include "Label.h"
 # include "Register.h"
+# include "Output.h"
 # include <map>
 # include <iterator>
+# include <atomic>
+# include <thread>
+# include <sstream>
 
 using namespace std;
 
-std::ostream& os = std::cout;
+Output output;
+bool useIR, emitIR, optimizeSize;
+unsigned optimization;
+atomic<unsigned long> spills, reloads;
+static thread_local ostream out(nullptr);
+static unsigned labels;
 
-static int offset;
-static string funcname;
+static thread_local int offset;
+static thread_local Atom funcname;
 static ostream &operator <<(ostream &ostr, Expression *expr);
 
-static Register *eax = new Register("%eax", "%al");
-static Register *ecx = new Register("%ecx", "%cl");
-static Register *edx = new Register("%edx", "%dl");
+static thread_local Register eax("%eax", "%al");
+static thread_local Register ecx("%ecx", "%cl");
+static thread_local Register edx("%edx", "%dl");
+
+static thread_local Register ebx("%ebx", "%bl");
+static thread_local Register esi("%esi");
+static thread_local Register edi("%edi");
 
-static vector<Register *> registers = {eax, ecx, edx};
+static thread_local vector<Register *> registers = {&eax, &ecx, &edx};
+static thread_local vector<Register *> callee = {&ebx, &esi, &edi};
 
-map<std::string, Label> strings;
+static thread_local map<std::string, Label> strings;
+static thread_local vector<int> slots;
+
+struct Code {
+    string text;
+    unsigned labels;
+};
 
 
 /*
@@ -72,12 +126,15 @@ static ostream &operator <<(ostream &ostr, Expression *expr)
  * Function:	Expression::operand
  *
  * Description:	Write an expression as an operand to the specified stream.
+ *		Only an expression that was spilled has no other operand,
+ *		so this is a reload.
  */
 
 void Expression::operand(ostream &ostr) const
 {
     assert(_offset != 0);
     ostr << _offset << "(%ebp)";
+    reloads ++;
 }
 
 
@@ -89,13 +146,35 @@ void Expression::operand(ostream &ostr) const
 
 void Identifier::operand(ostream &ostr) const
 {
-    if (_symbol->_offset == 0)
+    if (_symbol->_register != nullptr)
+	ostr << _symbol->_register;
+    else if (_symbol->_offset == 0)
 	ostr << global_prefix << _symbol->name();
     else
 	ostr << _symbol->_offset << "(%ebp)";
 }
 
 
+/*
+ * Function:	Address::operand
+ *
+ * Description:	Write an address as an operand to the specified stream.
+ *		The address of a global is a constant, so it need not have
+ *		been spilled.
+ */
+
+void Address::operand(ostream &ostr) const
+{
+    const Symbol *symbol;
+
+
+    if (_expr->isIdentifier(symbol) && symbol->_offset == 0)
+	ostr << "$" << global_prefix << symbol->name();
+    else
+	Expression::operand(ostr);
+}
+
+
 /*
  * Function:	Number::operand
  *
@@ -165,7 +244,7 @@ void Call::generate()
     /* Align the stack if necessary. */
 
     if (align(numBytes) != 0) {
-	cout << "\tsubl\t$" << align(numBytes) << ", %esp" << endl;
+	out << "\tsubl\t$" << align(numBytes) << ", %esp\n";
 	numBytes += align(numBytes);
     }
 
@@ -176,23 +255,23 @@ void Call::generate()
 	if (STACK_ALIGNMENT == SIZEOF_ARG || !_args[i]->_hasCall)
 	    _args[i]->generate();
 
-	cout << "\tpushl\t" << _args[i] << endl;
+	out << "\tpushl\t" << _args[i] << "\n";
 	assign(_args[i], nullptr);
     }
 
 
     /* Call the function and then reclaim the stack space. */
 
-    load(nullptr, eax);
-    load(nullptr, ecx);
-    load(nullptr, edx);
+    load(nullptr, &eax);
+    load(nullptr, &ecx);
+    load(nullptr, &edx);
 
-    cout << "\tcall\t" << global_prefix << _id->name() << endl;
+    out << "\tcall\t" << global_prefix << _id->name() << "\n";
 
     if (numBytes > 0)
-	cout << "\taddl\t$" << numBytes << ", %esp" << endl;
+	out << "\taddl\t$" << numBytes << ", %esp\n";
 
-    assign(this, eax);
+    assign(this, &eax);
 }
 
 
@@ -228,17 +307,44 @@ void Simple::generate()
 }
 
 
+/*
+ * Function:	generateStrings (private)
+ *
+ * Description:	Generate the string literals used by the function just
+ *		generated.
+ */
+
+static void generateStrings()
+{
+    if (!strings.empty()) {
+	out << ".data\n";
+
+	for (auto str : strings)
+	    out << str.second << ":\t.asciz\t\"" << str.first << "\"\n";
+
+	out << ".text\n\n";
+	strings.clear();
+    }
+}
+
+
 /*
  * Function:	Function::generate
  *
  * Description:	Generate code for this function, which entails allocating
- *		space for local variables, then emitting our prologue, the
- *		body of the function, and the epilogue.
+ *		space and registers for local variables, then emitting our
+ *		prologue, the body of the function, and the epilogue.  With
+ *		--ir or -O1, the function is instead translated into the
+ *		IR, which is optimized, and the instructions are selected
+ *		from that.  With --emit-ir, the IR is written instead.
  */
 
 void Function::generate()
 {
     int param_offset;
+    Procedure *procedure;
+    vector<Register *> saved;
+    vector<int> homes;
 
 
     /* Assign offsets to the parameters and local variables. */
@@ -248,13 +354,46 @@ void Function::generate()
     allocate(offset);
 
 
-    /* Generate our prologue. */
+    /* Go by way of the IR if asked. */
+
+    if (useIR || emitIR || optimization > 0) {
+	procedure = lower();
+	procedure->optimize(optimization);
+
+	if (emitIR)
+	    procedure->write(out);
+	else
+	    procedure->select(out, offset);
+
+	delete procedure;
+	generateStrings();
+	return;
+    }
+
+
+    /* Generate our prologue, saving any registers given to variables
+       and loading any parameters kept in them. */
 
     funcname = _id->name();
-    cout << global_prefix << funcname << ":" << endl;
-    cout << "\tpushl\t%ebp" << endl;
-    cout << "\tmovl\t%esp, %ebp" << endl;
-    cout << "\tsubl\t$" << funcname << ".size, %esp" << endl;
+    saved = allocate(callee);
+    slots.clear();
+    out << global_prefix << funcname << ":\n";
+    out << "\tpushl\t%ebp\n";
+    out << "\tmovl\t%esp, %ebp\n";
+    out << "\tsubl\t$" << funcname << ".size, %esp\n";
+
+    for (auto reg : saved) {
+	offset -= SIZEOF_REG;
+	homes.push_back(offset);
+	out << "\tmovl\t" << reg << ", " << offset << "(%ebp)\n";
+    }
+
+    for (unsigned i = 0; i < _id->type().parameters()->size(); i ++) {
+	const Symbol *symbol = _body->declarations()->symbols()[i];
+
+	if (symbol->_register != nullptr)
+	    out << "\tmovl\t" << symbol->_offset << "(%ebp), " << symbol->_register << "\n";
+    }
 
 
     /* Generate the body of this function. */
@@ -264,14 +403,127 @@ void Function::generate()
 
     /* Generate our epilogue. */
 
-    cout << endl << global_prefix << funcname << ".exit:" << endl;
-    cout << "\tmovl\t%ebp, %esp" << endl;
-    cout << "\tpopl\t%ebp" << endl;
-    cout << "\tret" << endl << endl;
+    out << "\n" << global_prefix << funcname << ".exit:\n";
+
+    for (unsigned i = 0; i < saved.size(); i ++)
+	out << "\tmovl\t" << homes[i] << "(%ebp), " << saved[i] << "\n";
+
+    out << "\tmovl\t%ebp, %esp\n";
+    out << "\tpopl\t%ebp\n";
+    out << "\tret\n\n";
 
     offset -= align(offset - param_offset);
-    cout << "\t.set\t" << funcname << ".size, " << -offset << endl;
-    cout << "\t.globl\t" << global_prefix << funcname << endl << endl;
+    out << "\t.set\t" << funcname << ".size, " << -offset << "\n";
+    out << "\t.globl\t" << global_prefix << funcname << "\n\n";
+    generateStrings();
+
+
+    /* The trees of this function are about to be freed. */
+
+    for (auto reg : registers)
+	reg->_node = nullptr;
+}
+
+
+/*
+ * Function:	generateFunction (private)
+ *
+ * Description:	Generate code for the given function into its own buffer,
+ *		and record how many labels it used.
+ */
+
+static void generateFunction(Function *function, Code &code)
+{
+    stringbuf buffer;
+
+
+    out.rdbuf(&buffer);
+    Label::restart();
+    function->generate();
+
+    out.rdbuf(nullptr);
+    code.text = buffer.str();
+    code.labels = Label::count();
+}
+
+
+/*
+ * Function:	work (private)
+ *
+ * Description:	Repeatedly take the next function that nobody has started
+ *		on yet and generate code for it, until there are none left.
+ */
+
+static void work(const vector<Function *> &functions, vector<Code> &code,
+		 atomic<unsigned> &next)
+{
+    unsigned i;
+
+    while ((i = next ++) < functions.size())
+	generateFunction(functions[i], code[i]);
+}
+
+
+/*
+ * Function:	stitch (private)
+ *
+ * Description:	Write the code for a function to the output, renumbering
+ *		its labels to follow those of the functions before it.
+ */
+
+static void stitch(const Code &code)
+{
+    const string &text = code.text;
+    size_t start, marker;
+    unsigned number;
+
+
+    start = 0;
+
+    while ((marker = text.find(Label::marker, start)) != string::npos) {
+	out.write(text.data() + start, marker - start);
+	number = 0;
+
+	for (start = marker + 1; isdigit(text[start]); start ++)
+	    number = number * 10 + text[start] - '0';
+
+	out << labels + number;
+    }
+
+    out.write(text.data() + start, text.size() - start);
+    labels += code.labels;
+}
+
+
+/*
+ * Function:	generateFunctions
+ *
+ * Description:	Generate code for the given functions using the given
+ *		number of threads, including this one, and write it to the
+ *		output in order.
+ */
+
+void generateFunctions(const vector<Function *> &functions, unsigned jobs)
+{
+    vector<Code> code(functions.size());
+    vector<thread> workers;
+    atomic<unsigned> next(0);
+
+
+    for (unsigned i = 1; i < jobs && i < functions.size(); i ++)
+	workers.push_back(thread(work, cref(functions), ref(code), ref(next)));
+
+    work(functions, code, next);
+
+    for (auto &worker : workers)
+	worker.join();
+
+    out.rdbuf(&output);
+
+    for (auto &c : code)
+	stitch(c);
+
+    out.flush();
 }
 
 
@@ -285,73 +537,483 @@ void generateGlobals(Scope *scope)
 {
     const Symbols &symbols = scope->symbols();
 
+
+    out.rdbuf(&output);
+
+    if (emitIR)
+	return;
+
     for (auto symbol : symbols)
         if (!symbol->type().isFunction()) {
-            cout << "\t.comm\t" << global_prefix << symbol->name() << ", ";
-            cout << symbol->type().size() << endl;
+            out << "\t.comm\t" << global_prefix << symbol->name() << ", ";
+            out << symbol->type().size() << "\n";
         }
 
-    cout << ".data" << endl;
-    for (auto str: strings){
-        cout << str.second << ":\t.asciz\t\"" << str.first <<"\"" << endl;
+    out.flush();
+}
+
+
+/*
+ * Function:	operands (private)
+ *
+ * Description:	Generate code for the operands of a binary operator,
+ *		computing the one needing more registers first.  Only the
+ *		order of evaluation changes: the left operand is still the
+ *		left operand of the instruction, so subtraction, division,
+ *		and comparison need no fix-up.
+ */
+
+static void operands(Expression *left, Expression *right)
+{
+    if (Binary::rightFirst(left, right)) {
+	right->generate();
+	left->generate();
+    } else {
+	left->generate();
+	right->generate();
     }
+}
+
 
+/*
+ * Instruction selection.  Once generated, an expression can be used
+ * directly as one of several kinds of operand: a number or the address of
+ * a global is an immediate, a scalar variable is in memory unless it is
+ * kept in a register, and a computed value is in a scratch register, or
+ * in memory if it was spilled.  Anything can be loaded into a scratch
+ * register at the cost of an instruction.  A tile gives the kinds of
+ * destination and source operands an instruction accepts, and the
+ * cheapest tile is chosen, that is, the one needing the fewest loads to
+ * make the operands fit.
+ */
+
+enum {
+    IMMEDIATE = 1, MEMORY = 2, REGISTER = 4, SCRATCH = 8,
+    ANY = IMMEDIATE | MEMORY | REGISTER
+};
+
+struct Tile {
+    unsigned dest, source;
+};
+
+static const unsigned infinity = ~0u;
+
+
+/* An arithmetic instruction leaves its result in a scratch register. */
+
+static const Tile arithmetic[] = {
+    {SCRATCH, ANY},
+};
+
+
+/* At most one operand of a move or comparison is in memory. */
+
+static const Tile twoAddress[] = {
+    {REGISTER, ANY},
+    {MEMORY, IMMEDIATE | REGISTER},
+};
+
+
+/*
+ * Function:	kind (private)
+ *
+ * Description:	Return the kinds of operand that an expression already
+ *		generated can be used as without being loaded.  A char or
+ *		an array can only be used once loaded.
+ */
+
+static unsigned kind(const Expression *expr)
+{
+    unsigned value;
+    const Symbol *symbol;
+    Expression *operand;
+
+
+    if (expr->_register != nullptr)
+	return REGISTER | SCRATCH;
+
+    if (expr->isNumber(value))
+	return IMMEDIATE;
+
+    if (expr->isAddress(operand) && operand->isIdentifier(symbol))
+	return symbol->_offset == 0 ? IMMEDIATE : 0;
+
+    if (expr->isIdentifier(symbol)) {
+	if (symbol->_register != nullptr)
+	    return REGISTER;
+
+	if (symbol->type().isArray() || symbol->type().size() != SIZEOF_REG)
+	    return 0;
+
+	return MEMORY;
+    }
+
+    return expr->_offset != 0 ? MEMORY : 0;
 }
 
 
 /*
- * Function:	Assignment::generate
+ * Function:	cost (private)
  *
- * Description:	Generate code for an assignment statement.
+ * Description:	Return the cost of using an expression as one of the given
+ *		kinds of operand, which is the number of loads needed.
+ */
+
+static unsigned cost(const Expression *expr, unsigned kinds)
+{
+    if (kind(expr) & kinds)
+	return 0;
+
+    return kinds & (REGISTER | SCRATCH) ? 1 : infinity;
+}
+
+
+/*
+ * Function:	cost (private)
+ *
+ * Description:	Return the cost of matching a tile with the given
+ *		destination and source operands.
+ */
+
+static unsigned cost(const Tile &tile, const Expression *dest,
+		     const Expression *source)
+{
+    unsigned first, second;
+
+
+    first = cost(dest, tile.dest);
+    second = cost(source, tile.source);
+
+    if (first == infinity || second == infinity)
+	return infinity;
+
+    return first + second;
+}
+
+
+/*
+ * Function:	fit (private)
+ *
+ * Description:	Load an expression into a scratch register if it cannot
+ *		be used as one of the given kinds of operand.
+ */
+
+static void fit(Expression *expr, unsigned kinds)
+{
+    if (!(kind(expr) & kinds))
+	load(expr, getreg());
+}
+
+
+/*
+ * Function:	sources (private)
+ *
+ * Description:	Return the kinds of source operand that can be used with
+ *		the given destination, which cannot itself be loaded.
+ */
+
+static unsigned sources(const Expression *dest)
+{
+    for (auto &tile : twoAddress)
+	if (kind(dest) & tile.dest)
+	    return tile.source;
+
+    return 0;
+}
+
+
+/*
+ * Function:	update (private)
+ *
+ * Description:	Return whether an assignment adds to or subtracts from the
+ *		scalar variable being assigned, in which case it is done
+ *		in place by a read-modify-write instruction, and also
+ *		return the opcode and the other operand.
+ */
+
+static bool update(Expression *left, Expression *right, string &opcode,
+		   Expression *&source)
+{
+    const Symbol *symbol, *other;
+    Expression *x, *y;
+
+
+    if (!left->isIdentifier(symbol) || kind(left) == 0)
+	return false;
+
+    if (right->isAdd(x, y)) {
+	opcode = "addl";
+
+	if (x->isIdentifier(other) && other == symbol) {
+	    source = y;
+	    return true;
+	}
+
+	if (y->isIdentifier(other) && other == symbol) {
+	    source = x;
+	    return true;
+	}
+
+    } else if (right->isSubtract(x, y)) {
+	opcode = "subl";
+
+	if (x->isIdentifier(other) && other == symbol) {
+	    source = y;
+	    return true;
+	}
+    }
+
+    return false;
+}
+
+
+/*
+ * Addressing modes.  The address of an array element is computed by the
+ * tree as the base plus the index times the size of an element, which x86
+ * can compute itself as part of the instruction using it, written as
+ * displacement(base, index, scale).  The address of a global array becomes
+ * the displacement, and the address of a local array becomes an offset
+ * from the frame pointer, so neither needs a register.
+ */
+
+struct Mode {
+    const Symbol *global;
+    int offset;
+    bool frame;
+    Expression *base, *index;
+    unsigned scale;
+};
+
+
+/*
+ * Function:	match (private)
+ *
+ * Description:	Match the address used by a dereference to the addressing
+ *		mode that computes as much of it as possible.
+ */
+
+static void match(Expression *pointer, Mode &mode)
+{
+    Expression *left, *right, *expr, *size;
+    const Symbol *symbol;
+    unsigned value;
+
+
+    mode.global = nullptr;
+    mode.offset = 0;
+    mode.frame = false;
+    mode.base = pointer;
+    mode.index = nullptr;
+    mode.scale = 1;
+
+    if (pointer->isAdd(left, right)) {
+	if (!left->type().isPointer())
+	    std::swap(left, right);
+
+	mode.base = left;
+
+	if (right->isNumber(value))
+	    mode.offset = value;
+	else if (right->isMultiply(expr, size) && size->isNumber(value) &&
+		(value == 1 || value == 2 || value == 4 || value == 8)) {
+	    mode.index = expr;
+	    mode.scale = value;
+	} else
+	    mode.index = right;
+    }
+
+    if (mode.base->isAddress(expr) && expr->isIdentifier(symbol)) {
+	mode.base = nullptr;
+
+	if (symbol->_offset == 0)
+	    mode.global = symbol;
+	else {
+	    mode.offset += symbol->_offset;
+	    mode.frame = true;
+	}
+    }
+}
+
+
+/*
+ * Function:	prepare (private)
+ *
+ * Description:	Generate code for the base and index of an addressing
+ *		mode, and make sure they are in registers.
+ */
+
+static void prepare(Mode &mode)
+{
+    if (mode.base != nullptr && mode.index != nullptr)
+	operands(mode.base, mode.index);
+    else if (mode.base != nullptr)
+	mode.base->generate();
+    else if (mode.index != nullptr)
+	mode.index->generate();
+
+    if (mode.base != nullptr)
+	fit(mode.base, REGISTER);
+
+    if (mode.index != nullptr)
+	fit(mode.index, REGISTER);
+}
+
+
+/*
+ * Function:	target (private)
+ *
+ * Description:	Return a scratch register to hold a value computed from an
+ *		addressing mode, reusing that of the base or index.
+ */
+
+static Register *target(const Mode &mode)
+{
+    if (mode.base != nullptr && mode.base->_register != nullptr)
+	return mode.base->_register;
+
+    if (mode.index != nullptr && mode.index->_register != nullptr)
+	return mode.index->_register;
+
+    return getreg();
+}
+
+
+/*
+ * Function:	finish (private)
+ *
+ * Description:	Release the registers holding the base and index of an
+ *		addressing mode once the instruction using it is written.
+ */
+
+static void finish(const Mode &mode)
+{
+    if (mode.base != nullptr)
+	assign(mode.base, nullptr);
+
+    if (mode.index != nullptr)
+	assign(mode.index, nullptr);
+}
+
+
+/*
+ * Function:	operator << (private)
+ *
+ * Description:	Write an addressing mode as an operand.
+ */
+
+static ostream &operator <<(ostream &ostr, const Mode &mode)
+{
+    if (mode.global != nullptr) {
+	ostr << global_prefix << mode.global->name();
+
+	if (mode.offset != 0)
+	    ostr << showpos << mode.offset << noshowpos;
+
+    } else if (mode.offset != 0)
+	ostr << mode.offset;
+
+    if (mode.frame)
+	ostr << "(%ebp";
+    else if (mode.base != nullptr)
+	ostr << "(" << mode.base;
+    else if (mode.index != nullptr)
+	ostr << "(";
+    else
+	return ostr;
+
+    if (mode.index != nullptr)
+	ostr << "," << mode.index << "," << mode.scale;
+
+    return ostr << ")";
+}
+
+
+/*
+ * Function:	Assignment::generate
  *
- *		NOT FINISHED: Only works if the right-hand side is an
- *		integer literal and the left-hand side is an integer
- *		scalar.
+ * Description:	Generate code for an assignment statement.  Adding to or
+ *		subtracting from a scalar variable is done in place.
+ *		Otherwise, the value is stored directly from an immediate
+ *		or a register, or from memory if the variable is kept in a
+ *		register.  A char is stored from an immediate or the low
+ *		byte of a scratch register.
  */
 
 void Assignment::generate() {
-    Expression *pointer;
+    Expression *pointer, *source;
+    unsigned value;
+    string opcode;
+    Mode mode;
+
+    if(update(_left, _right, opcode, source)){
+        source->generate();
+        fit(source, sources(_left));
+        out << "\t" << opcode << "\t" << source << ", " << _left << "\n";
+        assign(source, nullptr);
+        return;
+    }
+
     _right->generate();
 
     if(_left->isDereference(pointer)){
-        pointer->generate();
-        if(pointer->_register == nullptr){
-            load(pointer, getreg());
-        }
-        if(_right->_register == nullptr){
-            load(_right, getreg());
-        }
-        
+        match(pointer, mode);
+        prepare(mode);
+
         if(_left->type().size() == SIZEOF_CHAR){
-            cout << "\tmovb\t" << _right->_register->byte() << ", (" << pointer << ")" << endl;
-         }else{
-            cout << "\tmovl\t" << _right << ", (" << pointer << ")" << endl;
+            if(_right->isNumber(value)){
+                out << "\tmovb\t$" << (value & 0xff) << ", " << mode << "\n";
+            }else{
+                if(_right->_register == nullptr)
+                    load(_right, getreg());
+                out << "\tmovb\t" << _right->_register->byte() << ", " << mode << "\n";
+            }
+        }else{
+            fit(_right, IMMEDIATE | REGISTER);
+            out << "\tmovl\t" << _right << ", " << mode << "\n";
         }
-        
-        assign(pointer, nullptr);
-        
+
+        finish(mode);
+
     }else{
-        if(_right->_register == nullptr){
-            load(_right, getreg());
-        }
         if(_left->type().size() == SIZEOF_CHAR){
-            cout << "\tmovb\t" << _right->_register->byte() << ", " << _left << endl;
-         }else{
-            cout << "\tmovl\t" << _right << ", " << _left << endl;
+            if(_right->isNumber(value)){
+                out << "\tmovb\t$" << (value & 0xff) << ", " << _left << "\n";
+            }else{
+                if(_right->_register == nullptr)
+                    load(_right, getreg());
+                out << "\tmovb\t" << _right->_register->byte() << ", " << _left << "\n";
+            }
+        }else{
+            fit(_right, sources(_left));
+            out << "\tmovl\t" << _right << ", " << _left << "\n";
         }
     }
     
     assign(_right, nullptr);
 }
 
+/*
+ * Function:	compute (private)
+ *
+ * Description:	Generate code for an arithmetic operator, whose result is
+ *		left in the register holding its destination operand.  If
+ *		the operator commutes, the operands are exchanged when
+ *		that is cheaper, such as when only the right operand is
+ *		already in a register.
+ */
+
 static void compute(Expression *result, Expression *left, Expression *right, const string &opcode){
-    left->generate();
-    right->generate();
+    const Tile &tile = arithmetic[0];
+
+    operands(left, right);
 
-    if (left->_register == nullptr)
-        load(left, getreg());
+    if ((opcode == "addl" || opcode == "imull") && cost(tile, right, left) < cost(tile, left, right))
+        std::swap(left, right);
 
-    cout << "\t"<< opcode <<"\t" << right << ", " << left << endl;
+    fit(left, tile.dest);
+    fit(right, tile.source);
+
+    out << "\t"<< opcode <<"\t" << right << ", " << left << "\n";
 
     assign(right, nullptr);
     assign(result, left->_register);
@@ -365,31 +1027,307 @@ void Subtract::generate() {
     compute(this, _left, _right, "subl");
 }
 
+/*
+ * Function:	constant (private)
+ *
+ * Description:	Return whether an expression is a number, and its value
+ *		as a signed integer.
+ */
+
+static bool constant(const Expression *expr, int &value)
+{
+    unsigned number;
+
+
+    if (!expr->isNumber(number))
+	return false;
+
+    value = number;
+    return true;
+}
+
+
+/*
+ * Function:	power (private)
+ *
+ * Description:	Return the base two logarithm of a value if it is a power
+ *		of two, and zero otherwise.
+ */
+
+static unsigned power(unsigned value)
+{
+    unsigned k;
+
+
+    if (value < 2 || (value & (value - 1)) != 0)
+	return 0;
+
+    for (k = 0; value > 1; k ++)
+	value >>= 1;
+
+    return k;
+}
+
+
+/*
+ * Function:	multiply (private)
+ *
+ * Description:	Generate code to multiply an expression by a constant.
+ *		A power of two is a shift, and three, five, or nine times
+ *		a power of two is a leal followed by a shift.  Anything
+ *		else is left to imull.
+ */
+
+static void multiply(Expression *result, Expression *expr, int value)
+{
+    unsigned factor, k;
+
+
+    expr->generate();
+    fit(expr, SCRATCH);
+
+    factor = value;
+    k = 0;
+
+    if (value > 0)
+	for (; factor % 2 == 0; factor /= 2)
+	    k ++;
+
+    if (value == 0)
+	out << "\txorl\t" << expr << ", " << expr << "\n";
+
+    else if (value == -1)
+	out << "\tnegl\t" << expr << "\n";
+
+    else if (value > 0 && (factor == 1 || factor == 3 || factor == 5 || factor == 9)) {
+	if (factor > 1)
+	    out << "\tleal\t(" << expr << "," << expr << "," << factor - 1 << "), " << expr << "\n";
+
+	if (k > 0)
+	    out << "\tsall\t$" << k << ", " << expr << "\n";
+
+    } else
+	out << "\timull\t$" << value << ", " << expr << "\n";
+
+    assign(result, expr->_register);
+}
+
+
+/*
+ * Function:	magic (private)
+ *
+ * Description:	Compute the magic number and shift for signed division by
+ *		a constant, which must not be -1, 0, or 1 (Warren, Hacker's
+ *		Delight, section 10-4).  The quotient of x by the divisor
+ *		is then the high word of the magic number times x, adjusted
+ *		by x if the signs of the magic number and the divisor
+ *		differ, shifted right arithmetically, and plus one if it
+ *		is negative.
+ */
+
+static void magic(int divisor, int &multiplier, unsigned &shift)
+{
+    const unsigned two31 = 0x80000000;
+    unsigned ad, anc, delta, q1, r1, q2, r2, t;
+    int p;
+
+
+    ad = divisor < 0 ? -(unsigned) divisor : divisor;
+    t = two31 + ((unsigned) divisor >> 31);
+    anc = t - 1 - t % ad;
+    p = 31;
+    q1 = two31 / anc;
+    r1 = two31 - q1 * anc;
+    q2 = two31 / ad;
+    r2 = two31 - q2 * ad;
+
+    do {
+	p ++;
+	q1 = 2 * q1;
+	r1 = 2 * r1;
+
+	if (r1 >= anc) {
+	    q1 ++;
+	    r1 -= anc;
+	}
+
+	q2 = 2 * q2;
+	r2 = 2 * r2;
+
+	if (r2 >= ad) {
+	    q2 ++;
+	    r2 -= ad;
+	}
+
+	delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    multiplier = q2 + 1;
+
+    if (divisor < 0)
+	multiplier = -multiplier;
+
+    shift = p - 32;
+}
+
+
+/*
+ * Function:	divide (private)
+ *
+ * Description:	Generate code to divide an expression by a nonzero
+ *		constant, or to find the remainder, truncating toward zero
+ *		like idivl.  For a power of two, a negative dividend is
+ *		first biased by the divisor less one, found by shifting
+ *		its sign, so that the arithmetic shift rounds toward zero.
+ *		Otherwise, the quotient is found by multiplying by a magic
+ *		number, and the remainder from the quotient.
+ */
+
+static void divide(Expression *result, Expression *expr, int value, const string &op)
+{
+    unsigned k, shift;
+    int multiplier;
+    Register *temp;
+
+
+    expr->generate();
+    k = power(value < 0 ? -(unsigned) value : value);
+
+    if (value == 1 || value == -1) {
+	fit(expr, SCRATCH);
+
+	if (op == "rem")
+	    out << "\txorl\t" << expr << ", " << expr << "\n";
+	else if (value == -1)
+	    out << "\tnegl\t" << expr << "\n";
+
+	assign(result, expr->_register);
+
+    } else if (k > 0) {
+	fit(expr, SCRATCH);
+	temp = getreg();
+	out << "\tmovl\t" << expr << ", " << temp << "\n";
+
+	if (k > 1) {
+	    out << "\tsarl\t$31, " << temp << "\n";
+	    out << "\tshrl\t$" << 32 - k << ", " << temp << "\n";
+	} else
+	    out << "\tshrl\t$31, " << temp << "\n";
+
+	out << "\taddl\t" << temp << ", " << expr << "\n";
+
+	if (op == "rem") {
+	    out << "\tandl\t$" << (1u << k) - 1 << ", " << expr << "\n";
+	    out << "\tsubl\t" << temp << ", " << expr << "\n";
+	} else {
+	    out << "\tsarl\t$" << k << ", " << expr << "\n";
+
+	    if (value < 0)
+		out << "\tnegl\t" << expr << "\n";
+	}
+
+	assign(result, expr->_register);
+
+    } else {
+	magic(value, multiplier, shift);
+	load(expr, &ecx);
+	load(nullptr, &eax);
+	load(nullptr, &edx);
+
+	out << "\tmovl\t$" << multiplier << ", %eax\n";
+	out << "\timull\t%ecx\n";
+
+	if (value > 0 && multiplier < 0)
+	    out << "\taddl\t%ecx, %edx\n";
+	else if (value < 0 && multiplier > 0)
+	    out << "\tsubl\t%ecx, %edx\n";
+
+	if (shift > 0)
+	    out << "\tsarl\t$" << shift << ", %edx\n";
+
+	out << "\tmovl\t%edx, %eax\n";
+	out << "\tshrl\t$31, %eax\n";
+	out << "\taddl\t%eax, %edx\n";
+
+	if (op == "rem") {
+	    out << "\timull\t$" << value << ", %edx\n";
+	    out << "\tsubl\t%edx, %ecx\n";
+	    assign(result, &ecx);
+	} else {
+	    assign(expr, nullptr);
+	    assign(result, &edx);
+	}
+    }
+}
+
+
+/*
+ * Function:	Multiply::generate
+ *
+ * Description:	Generate code for a multiplication, which is strength
+ *		reduced if either operand is a constant.
+ */
+
 void Multiply::generate() {
-    compute(this, _left, _right, "imull");
+    int value;
+
+    if (constant(_right, value))
+        multiply(this, _left, value);
+    else if (constant(_left, value))
+        multiply(this, _right, value);
+    else
+        compute(this, _left, _right, "imull");
 }
 
+
+/*
+ * Function:	Divide::generate
+ *
+ * Description:	Generate code for a division, which is strength reduced if
+ *		the divisor is a constant other than zero, whose trap is
+ *		kept, and the most negative integer.
+ */
+
 void Divide::generate() {
-    computeDivOrRem(this, _left, _right, "div");
+    int value;
+
+    if (constant(_right, value) && value != 0 && value != INT_MIN)
+        divide(this, _left, value, "div");
+    else
+        computeDivOrRem(this, _left, _right, "div");
 }
 
+
+/*
+ * Function:	Remainder::generate
+ *
+ * Description:	Generate code for a remainder, which is strength reduced
+ *		just like a division.
+ */
+
 void Remainder::generate() {
-    computeDivOrRem(this, _left, _right, "rem");
+    int value;
+
+    if (constant(_right, value) && value != 0 && value != INT_MIN)
+        divide(this, _left, value, "rem");
+    else
+        computeDivOrRem(this, _left, _right, "rem");
 }
+
 static void computeDivOrRem(Expression *result, Expression *left, Expression *right, const string &op){
-    left->generate();
-    right->generate();
+    operands(left, right);
     load(left, registers[0]); // allocate eax
     load(nullptr, registers[2]); // ensure edx empty
 
-    //cout << "\tmovl\t%eax, %edx" << endl;
-    cout << "\tcltd" << endl;
+    //out << "\tmovl\t%eax, %edx\n";
+    out << "\tcltd\n";
     load(right, registers[1]);
-    cout << "\tidivl\t" << right << endl;
+    out << "\tidivl\t" << right << "\n";
     assign(right, nullptr);
     if (op == "div"){
         assign(result, registers[0]);
     }else{
+        assign(left, nullptr);
         assign(result, registers[2]);
     }
 
@@ -404,32 +1342,65 @@ void Cast::generate() {
     }
 }
 
+/*
+ * Function:	Address::generate
+ *
+ * Description:	Generate code for an address expression.  The address of
+ *		an array element is computed by a single leal using the
+ *		addressing mode of the element.
+ */
+
 void Address::generate() {
     Expression *pointer;
+    Register *reg;
+    Mode mode;
 
     if (_expr->isDereference(pointer)){
-        pointer->generate();
-        if (pointer->_register == nullptr)
-            load(pointer, getreg());
-
-        assign(this, pointer->_register);
+        match(pointer, mode);
+
+        if (mode.base == pointer){
+            pointer->generate();
+            if (pointer->_register == nullptr)
+                load(pointer, getreg());
+
+            assign(this, pointer->_register);
+        }else{
+            prepare(mode);
+            reg = target(mode);
+            out << "\tleal\t" << mode << ", " << reg << "\n";
+            finish(mode);
+            assign(this, reg);
+        }
     } else{
         assign(this, getreg());
-        cout << "\tleal\t" << _expr << ", " << this << endl;
+        out << "\tleal\t" << _expr << ", " << this << "\n";
     }
 }
 
+
+/*
+ * Function:	Dereference::generate
+ *
+ * Description:	Generate code for a dereference, loading the value using
+ *		the addressing mode matched by its address.
+ */
+
 void Dereference::generate(){
-    _expr->generate();
-    if(_expr->_register == nullptr)
-        load(_expr, getreg());
+    Register *reg;
+    Mode mode;
+
+    match(_expr, mode);
+    prepare(mode);
+    reg = target(mode);
 
     if(_type.size() == SIZEOF_CHAR){
-        cout << "\tmovsbl\t(" << _expr << "), " << _expr << endl;
+        out << "\tmovsbl\t" << mode << ", " << reg << "\n";
     }else{
-        cout << "\tmovl\t(" << _expr << "), " << _expr << endl;
+        out << "\tmovl\t" << mode << ", " << reg << "\n";
     }
-    assign(this, _expr->_register);
+
+    finish(mode);
+    assign(this, reg);
 }
 
 void Negate::generate() {
@@ -438,7 +1409,7 @@ void Negate::generate() {
         load(_expr, getreg());
     }
 
-    cout << "\tnegl\t" << _expr << endl;
+    out << "\tnegl\t" << _expr << "\n";
     assign(this, _expr->_register);
 }
 
@@ -448,9 +1419,9 @@ void Not::generate() {
         load(_expr, getreg());
     }
 
-    cout << "\tcmpl\t$0, " << _expr << endl;
-    cout << "\tsete\t" << _expr->_register->byte() << endl;
-    cout << "\tmovzbl\t" << _expr->_register->byte() << ", " << _expr->_register << endl;
+    out << "\tcmpl\t$0, " << _expr << "\n";
+    out << "\tsete\t" << _expr->_register->byte() << "\n";
+    out << "\tmovzbl\t" << _expr->_register->byte() << ", " << _expr->_register << "\n";
     assign(this, _expr->_register);
 }
 
@@ -459,32 +1430,115 @@ void Not::test(const Label &label, bool ifTrue){
     assign(this, nullptr);
 }
 
+/*
+ * Function:	Expression::test
+ *
+ * Description:	Generate code to test an expression against zero and jump
+ *		to the given label.  A variable in memory is compared
+ *		against zero directly, and anything else is tested in a
+ *		register, which needs no immediate.
+ */
+
 void Expression::test(const Label &label, bool ifTrue) {
     generate();
-    if (_register == nullptr){
-        load(this, getreg());
+
+    if (kind(this) == MEMORY){
+        out << "\tcmpl\t$0, " << this << "\n";
+    }else{
+        fit(this, REGISTER);
+        out << "\ttestl\t" << this << ", " << this << "\n";
     }
 
-    cout << "\tcmpl\t$0, " << this << endl;
-    cout << (ifTrue ? "\tjne\t" : "\tje\t") << label << endl;
+    out << (ifTrue ? "\tjne\t" : "\tje\t") << label << "\n";
 
     assign(this, nullptr);
 
 }
 
+
+/*
+ * Function:	Number::test
+ *
+ * Description:	Generate code to test a number, which is known now: either
+ *		we always jump to the label or we never do.
+ */
+
+void Number::test(const Label &label, bool ifTrue) {
+    unsigned value;
+
+    isNumber(value);
+
+    if ((value != 0) == ifTrue)
+        out << "\tjmp\t" << label << "\n";
+}
+
+
+/*
+ * Function:	exchange (private)
+ *
+ * Description:	Return the conditional jump to use once the operands of
+ *		the comparison are exchanged.
+ */
+
+static string exchange(const string &jump)
+{
+    static const map<string, string> exchanged = {
+	{"jl", "jg"}, {"jg", "jl"}, {"jle", "jge"}, {"jge", "jle"},
+	{"jnl", "jng"}, {"jng", "jnl"}, {"jnle", "jnge"}, {"jnge", "jnle"},
+    };
+
+    auto it = exchanged.find(jump);
+    return it != exchanged.end() ? it->second : jump;
+}
+
+
+/*
+ * Function:	comparative
+ *
+ * Description:	Generate code for a comparison and a jump to the given
+ *		label.  The cheapest tile is chosen, with the operands
+ *		exchanged and the jump adjusted if that is cheaper, and
+ *		a comparison against zero of a value in a register uses
+ *		testl instead.
+ */
+
 void comparative(Expression *result, Expression *left, Expression *right, const Label &label, bool ifTrue, const string &op1, const string &op2){
-    left->generate();
-    right->generate();
-    if (left->_register == nullptr){
-        load(left, getreg());
+    const Tile *best = nullptr;
+    unsigned value, lowest = infinity;
+    bool swapped = false;
+    string jump = ifTrue ? op1 : op2;
+
+    operands(left, right);
+
+    for (auto &tile : twoAddress) {
+        if (cost(tile, left, right) < lowest) {
+            best = &tile;
+            lowest = cost(tile, left, right);
+            swapped = false;
+        }
+
+        if (cost(tile, right, left) < lowest) {
+            best = &tile;
+            lowest = cost(tile, right, left);
+            swapped = true;
+        }
     }
-    if (right->_register == nullptr){
-        load(right, getreg());
+
+    if (right->isNumber(value) && value == 0 && cost(left, REGISTER) <= lowest){
+        fit(left, REGISTER);
+        out << "\ttestl\t" << left << ", " << left << "\n";
+    }else{
+        if (swapped){
+            std::swap(left, right);
+            jump = exchange(jump);
+        }
+
+        fit(left, best->dest);
+        fit(right, best->source);
+        out << "\tcmpl\t" << right << ", " << left << "\n";
     }
-    
-    cout << "\tcmpl\t" << right << ", " << left << endl;
-    cout << "\t";
-    cout << (ifTrue ? op1 : op2 ) << "\t" << label << endl;
+
+    out << "\t" << jump << "\t" << label << "\n";
 
     assign(left, nullptr);
     assign(right, nullptr);
@@ -522,7 +1576,7 @@ void LogicalAnd::test(const Label &label, bool ifTrue){
         Label skip;
         _left->test(skip, false);
         _right->test(label, true);
-        cout << skip << ":" << endl;
+        out << skip << ":\n";
     }else{
         _left->test(label, false);
         _right->test(label, false);
@@ -538,21 +1592,52 @@ void LogicalOr::test(const Label &label, bool ifTrue){
         Label skip;
         _left->test(skip, true);
         _right->test(label, false);
-        cout << skip << ":" << endl;
+        out << skip << ":\n";
     }
     assign(this, nullptr);
 }
 
-void While::generate(){
-    Label loop, exit;
-    
-    cout << loop << ":" << endl;
+/*
+ * Function:	rotate (private)
+ *
+ * Description:	Generate code for a loop with the test at the bottom, so
+ *		that each iteration takes only the one conditional jump
+ *		back to the top.  The loop is guarded once on entry: when
+ *		optimizing for speed, by a copy of the test that jumps
+ *		past the loop, with the top of the loop aligned so that
+ *		it is fetched in as few blocks as possible; and when
+ *		optimizing for size, by a jump to the test at the bottom,
+ *		so the test is generated only once.  The increment of a
+ *		for loop, if any, follows the body.
+ */
+
+static void rotate(Expression *expr, Statement *stmt, Statement *incr)
+{
+    Label loop, next, exit;
+
+
+    if (optimizeSize)
+	out << "\tjmp\t" << next << "\n";
+    else {
+	expr->test(exit, false);
+	out << "\t.p2align\t4\n";
+    }
 
-    _expr->test(exit, false);
-    _stmt->generate();
+    out << loop << ":\n";
+    stmt->generate();
 
-    cout << "\tjmp\t" << loop << endl;
-    cout << exit << ":" << endl;
+    if (incr != nullptr)
+	incr->generate();
+
+    if (optimizeSize)
+	out << next << ":\n";
+
+    expr->test(loop, true);
+    out << exit << ":\n";
+}
+
+void While::generate(){
+    rotate(_expr, _stmt, nullptr);
 }
 
 void If::generate(){
@@ -563,43 +1648,80 @@ void If::generate(){
         _expr->test(exit, false);
     }
     _thenStmt->generate();
-    cout << "\tjmp\t" << exit << endl;
+    out << "\tjmp\t" << exit << "\n";
     if (_elseStmt != nullptr){
-        cout << elseL << ":" << endl;
+        out << elseL << ":\n";
         _elseStmt->generate();
-        cout << "\tjmp\t" << exit << endl;
+        out << "\tjmp\t" << exit << "\n";
     }
     
 
-    cout << exit << ":" << endl;
+    out << exit << ":\n";
 
 }
 
 void For::generate(){
-    Label loop, exit;
-
     _init->generate();
-    cout << loop << ":" << endl;
-    _expr->test(exit, false);
-    _stmt->generate();
-    _incr->generate();
-    cout << "\tjmp\t" << loop << endl;
-    cout << exit << ":" << endl;    
+    rotate(_expr, _stmt, _incr);
 }
 
 void Return::generate(){
     _expr->generate();
     
-    load(_expr, eax);
+    load(_expr, &eax);
     
-    cout << "\tjmp\t" << global_prefix << funcname << ".exit" << endl;
+    out << "\tjmp\t" << global_prefix << funcname << ".exit\n";
     assign(_expr, nullptr);
 
 }
 
 
+/*
+ * Function:	release (private)
+ *
+ * Description:	Return the stack slot of a spilled expression to the pool
+ *		of free slots, since its value is no longer needed there.
+ */
+
+static void release(Expression *expr)
+{
+    if (expr->_offset != 0) {
+	slots.push_back(expr->_offset);
+	expr->_offset = 0;
+    }
+}
+
+
+/*
+ * Function:	spill (private)
+ *
+ * Description:	Store the value in a register to a stack slot, reusing a
+ *		free slot if there is one, so that the frame only grows to
+ *		hold the most values ever spilled at once.  Every slot is
+ *		as large as a register, since that is what is stored, even
+ *		if the value is a char.
+ */
+
+static void spill(Register *reg)
+{
+    if (slots.empty()) {
+	offset -= SIZEOF_REG;
+	reg->_node->_offset = offset;
+    } else {
+	reg->_node->_offset = slots.back();
+	slots.pop_back();
+    }
+
+    out << "\tmovl\t" << reg << ", " << reg->_node->_offset << "(%ebp)\n";
+    spills ++;
+}
+
+
 void assign(Expression *expr, Register *reg){
     if (expr != nullptr) {
+        if (reg == nullptr)
+            release(expr);
+
         if (expr->_register != nullptr)
             expr->_register->_node = nullptr;
         expr->_register = reg;
@@ -613,29 +1735,84 @@ void assign(Expression *expr, Register *reg){
     }
 }
 
+
+/*
+ * Function:	cheap (private)
+ *
+ * Description:	Return whether the value of an expression is cheap to
+ *		compute again from its operand alone: a number, the value
+ *		of a scalar variable, or the address of a global.  Such a
+ *		value is never spilled, but simply dropped from its
+ *		register, since it is then written as that operand.  A
+ *		variable cannot change while its value is waiting in a
+ *		register, since there are no assignment expressions and a
+ *		variable is loaded only once the operands of its operator
+ *		have all been computed.
+ */
+
+static bool cheap(const Expression *expr)
+{
+    unsigned value;
+    const Symbol *symbol;
+    Expression *operand;
+
+
+    if (expr->isNumber(value))
+	return true;
+
+    if (expr->isIdentifier(symbol))
+	return !symbol->type().isArray() && symbol->type().size() == SIZEOF_REG;
+
+    if (expr->isAddress(operand) && operand->isIdentifier(symbol))
+	return symbol->_offset == 0;
+
+    return false;
+}
+
+
 void load(Expression *expr, Register *reg){
     if (reg->_node != expr){
         if (reg->_node != nullptr){
-            offset -= reg->_node->type().size();
-            reg->_node->_offset = offset;
-            cout << "\tmovl\t" << reg << ", ";
-            cout << offset << "(%ebp)" << endl;
+            if (cheap(reg->_node))
+                assign(reg->_node, nullptr);
+            else
+                spill(reg);
         }
 
         if (expr != nullptr){
-            cout << (expr->type().size() == 1 ? "\tmosbl\t" : "\tmovl\t");
-            cout << expr << ", " << reg << endl;
+            out << (expr->type().size() == 1 ? "\tmovsbl\t" : "\tmovl\t");
+            out << expr << ", " << reg << "\n";
+            release(expr);
         }
 
         assign(expr, reg);
     }
 }
 
+
+/*
+ * Function:	getreg
+ *
+ * Description:	Return a free register, spilling one if none are free.
+ *		Following Belady's rule, the register spilled is the one
+ *		whose value is used furthest in the future, as numbered by
+ *		the scan before generating the function.  Of two values
+ *		used at the same time, one that is cheap to compute again
+ *		is spilled first, since it needs no stack slot.
+ */
+
 Register *getreg(){
+    Register *victim = nullptr;
+
     for (auto reg : registers)
         if (reg->_node == nullptr)
             return reg;
-    
-    load(nullptr, registers[0]);
-    return registers[0];
+
+    for (auto reg : registers)
+        if (victim == nullptr || reg->_node->_use > victim->_node->_use ||
+                (reg->_node->_use == victim->_node->_use && cheap(reg->_node) && !cheap(victim->_node)))
+            victim = reg;
+
+    load(nullptr, victim);
+    return victim;
 }
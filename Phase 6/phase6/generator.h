@@ -10,7 +10,15 @@
 # define GENERATOR_H
 # include "Scope.h"
 # include "Tree.h"
+# include "Output.h"
+# include <atomic>
 
+extern Output output;
+extern bool useIR, emitIR, optimizeSize;
+extern unsigned optimization;
+extern std::atomic<unsigned long> spills, reloads;
+
+void generateFunctions(const std::vector<Function *> &functions, unsigned jobs);
 void generateGlobals(Scope *scope);
 static void compute(Expression *result, Expression *left, Expression *right, const std::string &opcode);
 static void computeDivOrRem(Expression *result, Expression *left, Expression *right, const std::string &op);
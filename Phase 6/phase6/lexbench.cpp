@@ -0,0 +1,56 @@
+/*
+ * File:	lexbench.cpp
+ *
+ * Description:	This file contains a driver for measuring the speed of the
+ *		lexical analyzer alone.  The given file is lexed to the
+ *		end, and the number of tokens, the number of them that are
+ *		keywords, and the rate at which they were lexed are
+ *		reported.  Identifier-heavy input for it is written by
+ *		lexbench.sh.
+ */
+
+# include <chrono>
+# include <cstdlib>
+# include <iostream>
+# include "lexer.h"
+# include "tokens.h"
+
+using namespace std;
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Lex the given file, or the standard input stream if none
+ *		is given, and report how quickly it was done.
+ */
+
+int main(int argc, char *argv[])
+{
+    chrono::steady_clock::time_point start;
+    unsigned long tokens = 0, keywords = 0;
+    double elapsed;
+    Lexeme lexeme;
+    int token;
+
+
+    if (!openInput(argc > 1 ? argv[1] : "")) {
+	cerr << argv[0] << ": cannot read " << argv[1] << endl;
+	return EXIT_FAILURE;
+    }
+
+    start = chrono::steady_clock::now();
+
+    while ((token = lexan(lexeme)) != DONE) {
+	tokens ++;
+
+	if (token != ID)
+	    keywords ++;
+    }
+
+    elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << tokens << " tokens, " << keywords << " keywords" << endl;
+    cout << "elapsed time: " << elapsed << " s" << endl;
+    cout << "throughput: " << (unsigned long) (tokens / elapsed) << " tokens/s" << endl;
+    return EXIT_SUCCESS;
+}
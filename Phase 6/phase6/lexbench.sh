@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# File:		lexbench.sh
+#
+# Description:	Measure the speed of the lexical analyzer on identifier-
+#		heavy input.  The input is a given number of words, by
+#		default three million, of which a fifth are keywords and
+#		the rest are common identifiers, half of them with a
+#		numeric suffix.  The words are chosen with a fixed seed, so
+#		the input is always the same.  The driver in lexbench.cpp
+#		is compiled with optimization against the lexer in this
+#		directory and run on the input.
+#
+# Usage:	sh lexbench.sh [words]
+#
+
+WORDS=${1:-3000000}
+TMP=${TMPDIR:-/tmp}/lexbench.$$
+
+trap 'rm -rf $TMP' 0 1 2 15
+mkdir $TMP || exit 1
+
+awk -v words=$WORDS 'BEGIN {
+    nk = split("auto break case char const continue default do double " \
+	"else enum extern float for goto if int long register return " \
+	"short signed sizeof static struct switch typedef union unsigned " \
+	"void volatile while", keywords)
+    ni = split("i j n sum count value ptr x1 tmp index result node left " \
+	"right data buffer length", identifiers)
+    srand(2)
+
+    for (k = 0; k < words; k ++) {
+	r = rand()
+
+	if (r < 0.2)
+	    word = keywords[int(rand() * nk) + 1]
+	else if (r < 0.6)
+	    word = identifiers[int(rand() * ni) + 1]
+	else
+	    word = identifiers[int(rand() * ni) + 1] (k % 100)
+
+	printf "%s%s", word, (k % 16 == 15 ? "\n" : " ")
+    }
+
+    printf "\n"
+}' > $TMP/input.c || exit 1
+
+${CXX:-g++} -std=c++11 -O2 -o $TMP/lexbench lexbench.cpp lexer.cpp \
+    Atom.cpp string.cpp || exit 1
+
+$TMP/lexbench $TMP/input.c
@@ -7,14 +7,21 @@
  *		Extra functionality:
  *		- checking for out of range integer literals
  *		- checking for invalid string literals
+ *		- reading from a file given by name as well as the standard
+ *		  input, entirely in memory
+ *		- releasing the part of a mapped file already read
  */
 
-# include <map>
 # include <cstdio>
+# include <cstring>
 # include <cerrno>
 # include <cctype>
 # include <cstdlib>
 # include <iostream>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
 # include "string.h"
 # include "tokens.h"
 # include "lexer.h"
@@ -22,10 +29,32 @@
 using namespace std;
 int numerrors, lineno = 1;
 
+static const char *cursor, *limit, *mark, *mapping;
 
-/* Later, we will associate token values with each keyword */
 
-static map<string, int> keywords = {
+/* Later, we will associate token values with each keyword.  Rather than
+   searching a map, we use a perfect hash, computed from the length and
+   the first and last characters, that sends each keyword to its own slot
+   in a table of size 64.  The table is filled in at compile time, and a
+   static assertion guarantees that no two keywords share a slot.  An
+   identifier is then a keyword only if it is identical to the one
+   keyword in its slot. */
+
+static constexpr unsigned length(const char *s)
+{
+    return *s != '\0' ? 1 + length(s + 1) : 0;
+}
+
+struct Keyword {
+    const char *name;
+    unsigned length;
+    int token;
+
+    constexpr Keyword(const char *name, int token)
+	: name(name), length(::length(name)), token(token) {}
+};
+
+static constexpr Keyword keywords[] = {
     {"auto", AUTO},
     {"break", BREAK},
     {"case", CASE},
@@ -60,6 +89,73 @@ static map<string, int> keywords = {
     {"while", WHILE},
 };
 
+static constexpr unsigned NUM_KEYWORDS = sizeof(keywords) / sizeof(keywords[0]);
+static constexpr unsigned MAX_KEYWORD = 8;
+static constexpr unsigned TABLE_SIZE = 64;
+
+static constexpr unsigned keyhash(unsigned first, unsigned last, unsigned length)
+{
+    return (first * 2 + (last + length) * 19) % TABLE_SIZE;
+}
+
+static constexpr unsigned keyhash(const Keyword &k)
+{
+    return keyhash(k.name[0], k.name[k.length - 1], k.length);
+}
+
+static constexpr unsigned slot(unsigned h, unsigned i = 0)
+{
+    return i == NUM_KEYWORDS ? NUM_KEYWORDS
+	: keyhash(keywords[i]) == h ? i : slot(h, i + 1);
+}
+
+static constexpr bool perfect(unsigned i = 0)
+{
+    return i == NUM_KEYWORDS || (slot(keyhash(keywords[i])) == i && perfect(i + 1));
+}
+
+static_assert(perfect(), "keyword hash has collisions");
+
+template<unsigned... I> struct Slots {
+    static const unsigned char table[sizeof...(I)];
+};
+
+template<unsigned... I>
+const unsigned char Slots<I...>::table[sizeof...(I)] = {slot(I)...};
+
+template<unsigned N, unsigned... I>
+struct Table : Table<N - 1, N - 1, I...> {};
+
+template<unsigned... I>
+struct Table<0, I...> : Slots<I...> {};
+
+
+/*
+ * Function:	keyword (private)
+ *
+ * Description:	Return the token for the given identifier lexeme, which
+ *		is the keyword's token if it is a keyword and ID
+ *		otherwise.  At most one string comparison is done.
+ */
+
+static int keyword(const Lexeme &lexeme)
+{
+    unsigned i;
+
+
+    if (lexeme.length > MAX_KEYWORD)
+	return ID;
+
+    i = Table<TABLE_SIZE>::table[keyhash((unsigned char) lexeme.text[0],
+	(unsigned char) lexeme.text[lexeme.length - 1], lexeme.length)];
+
+    if (i < NUM_KEYWORDS && keywords[i].length == lexeme.length &&
+	    memcmp(keywords[i].name, lexeme.text, lexeme.length) == 0)
+	return keywords[i].token;
+
+    return ID;
+}
+
 
 /*
  * Function:	report
@@ -81,27 +177,159 @@ void report(const string &str, const string &arg)
 }
 
 
+/*
+ * Function:	Lexeme::str
+ *
+ * Description:	Return a copy of this lexeme as a string.  Most lexemes
+ *		never need to be copied at all.
+ */
+
+string Lexeme::str() const
+{
+    return string(text, length);
+}
+
+
+/*
+ * Function:	openInput
+ *
+ * Description:	Make the file with the given path, or the standard input
+ *		if the path is empty, the input to the lexical analyzer.
+ *		A regular file is mapped into memory in its entirety, so
+ *		the lexer can scan it in place.  Anything else, such as a
+ *		pipe, is read into memory with one large read at a time.
+ *		Either way, the lexemes we return point into the input, so
+ *		it stays in memory until the parser says it is done with
+ *		it by calling releaseInput.
+ */
+
+bool openInput(const string &path)
+{
+    int fd;
+    struct stat st;
+    void *addr;
+    char *buffer;
+    size_t size, length;
+    ssize_t n;
+
+
+    fd = path.empty() ? 0 : open(path.c_str(), O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) < 0)
+	return false;
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+	addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (addr != MAP_FAILED) {
+	    mapping = mark = cursor = static_cast<const char *>(addr);
+	    limit = cursor + st.st_size;
+	    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+	    if (fd != 0)
+		close(fd);
+
+	    return true;
+	}
+    }
+
+    size = S_ISREG(st.st_mode) && st.st_size > 0 ? st.st_size : 1 << 16;
+    buffer = static_cast<char *>(malloc(size));
+    length = 0;
+
+    while (buffer != nullptr) {
+	if (length == size)
+	    buffer = static_cast<char *>(realloc(buffer, size *= 2));
+
+	else if ((n = read(fd, buffer + length, size - length)) > 0)
+	    length += n;
+
+	else if (n < 0 && errno == EINTR)
+	    continue;
+
+	else
+	    break;
+    }
+
+    if (fd != 0)
+	close(fd);
+
+    mark = cursor = buffer;
+    limit = buffer + length;
+    return buffer != nullptr;
+}
+
+
+/*
+ * Function:	releaseInput
+ *
+ * Description:	Release the memory holding any input before the most
+ *		recent lexeme, which the caller promises never to look at
+ *		again.  Only the pages of a mapped file can be released,
+ *		and they are simply reread from the file if needed.  Input
+ *		read into memory is kept until we exit.
+ */
+
+void releaseInput()
+{
+    static const size_t pagesize = sysconf(_SC_PAGESIZE);
+    size_t length;
+
+
+    if (mapping == nullptr)
+	return;
+
+    length = (mark - mapping) & ~(pagesize - 1);
+
+    if (length > 0) {
+	madvise(const_cast<char *>(mapping), length, MADV_DONTNEED);
+	mapping += length;
+    }
+}
+
+
+/*
+ * Function:	advance (private)
+ *
+ * Description:	Move past the current character of the input and return
+ *		the cursor one, or EOF if there are no more.
+ */
+
+static inline int advance()
+{
+    if (cursor < limit)
+	cursor ++;
+
+    return cursor < limit ? (unsigned char) *cursor : EOF;
+}
+
+
 /*
  * Function:	lexan
  *
- * Description:	Read and tokenize the standard input stream.  The lexeme is
- *		stored in a buffer.
+ * Description:	Tokenize the input.  The lexeme refers directly to the
+ *		input buffer, since every token consists of consecutive
+ *		characters of the input.  An identifier is also interned
+ *		and its atom returned as part of the lexeme.
  */
 
-int lexan(string &lexbuf)
+int lexan(Lexeme &lexeme)
 {
-    static int c = cin.get();
+    int c = cursor < limit ? (unsigned char) *cursor : EOF;
+    int token;
+    const char *start;
     bool invalid, overflow;
     long val;
     int p;
 
 
-    /* The invariant here is that the next character has already been read
+    /* The invariant here is that the cursor character has already been read
        and is ready to be classified.  In this way, we eliminate having to
-       push back characters onto the stream, merely to read them again. */
+       push back characters onto the stream, merely to read them again.
+       Since the input is entirely in memory, we know that the lexeme is
+       simply everything from where we started to where we stopped. */
 
-    while (!cin.eof()) {
-	lexbuf.clear();
+    while (cursor < limit) {
 
 
 	/* Ignore white space */
@@ -110,34 +338,38 @@ int lexan(string &lexbuf)
 	    if (c == '\n')
 		lineno ++;
 
-	    c = cin.get();
+	    c = advance();
 	}
 
+	lexeme.text = mark = start = cursor;
+
 
 	/* Check for an identifier or a keyword */
 
 	if (isalpha(c) || c == '_') {
-	    do {
-		lexbuf += c;
-		c = cin.get();
-	    } while (isalnum(c) || c == '_');
+	    do
+		c = advance();
+	    while (isalnum(c) || c == '_');
 
-	    if (keywords.count(lexbuf) > 0)
-		return keywords[lexbuf];
+	    lexeme.length = cursor - start;
+	    token = keyword(lexeme);
 
-	    return ID;
+	    if (token == ID)
+		lexeme.atom = Atom(lexeme.text, lexeme.length);
+
+	    return token;
 
 
 	/* Check for a number */
 
 	} else if (isdigit(c)) {
-	    do {
-		lexbuf += c;
-		c = cin.get();
-	    } while (isdigit(c));
+	    do
+		c = advance();
+	    while (isdigit(c));
 
+	    lexeme.length = cursor - start;
 	    errno = 0;
-	    val = strtol(lexbuf.c_str(), NULL, 0);
+	    val = strtol(lexeme.str().c_str(), NULL, 0);
 
 	    if (errno != 0 || val != (int) val)
 		report("integer constant too large");
@@ -151,7 +383,7 @@ int lexan(string &lexbuf)
 	   might as well do it now. */
 
 	} else {
-	    lexbuf += c;
+	    token = ERROR;
 
 	    switch(c) {
 
@@ -159,117 +391,116 @@ int lexan(string &lexbuf)
 	    /* Check for '||' */
 
 	    case '|':
-		c = cin.get();
+		c = advance();
 
-		if (c == '|') {
-		    lexbuf += c;
-		    c = cin.get();
-		}
+		if (c == '|')
+		    c = advance();
 
-		return OR;
+		token = OR;
+		break;
 
 
 	    /* Check for '=' and '==' */
 
 	    case '=':
-		c = cin.get();
+		c = advance();
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return EQL;
-		}
+		    c = advance();
+		    token = EQL;
+		} else
+		    token = '=';
 
-		return '=';
+		break;
 
 
 	    /* Check for '&' and '&&' */
 
 	    case '&':
-		c = cin.get();
+		c = advance();
 
 		if (c == '&') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return AND;
-		}
+		    c = advance();
+		    token = AND;
+		} else
+		    token = '&';
 
-		return '&';
+		break;
 
 
 	    /* Check for '!' and '!=' */
 
 	    case '!':
-		c = cin.get();
+		c = advance();
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return NEQ;
-		}
+		    c = advance();
+		    token = NEQ;
+		} else
+		    token = '!';
 
-		return '!';
+		break;
 
 
 	    /* Check for '<' and '<=' */
 
 	    case '<':
-		c = cin.get();
+		c = advance();
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return LEQ;
-		}
+		    c = advance();
+		    token = LEQ;
+		} else
+		    token = '<';
 
-		return '<';
+		break;
 
 
 	    /* Check for '>' and '>=' */
 
 	    case '>':
-		c = cin.get();
+		c = advance();
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return GEQ;
-		}
+		    c = advance();
+		    token = GEQ;
+		} else
+		    token = '>';
 
-		return '>';
+		break;
 
 
 	    /* Check for '-', '--', and '->' */
 
 	    case '-':
-		c = cin.get();
+		c = advance();
 
 		if (c == '-') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return DEC;
+		    c = advance();
+		    token = DEC;
 
 		} else if (c == '>') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return ARROW;
-		}
+		    c = advance();
+		    token = ARROW;
+
+		} else
+		    token = '-';
 
-		return '-';
+		break;
 
 
 	    /* Check for '+' and '++' */
 
 	    case '+':
-		c = cin.get();
+		c = advance();
 
 		if (c == '+') {
-		    lexbuf += c;
-		    c = cin.get();
-		    return INC;
-		}
+		    c = advance();
+		    token = INC;
+		} else
+		    token = '+';
 
-		return '+';
+		break;
 
 
 	    /* Check for simple, single character tokens */
@@ -277,32 +508,35 @@ int lexan(string &lexbuf)
 	    case '*': case '%': case ':': case ';':
 	    case '(': case ')': case '[': case ']':
 	    case '{': case '}': case '.': case ',':
-		c = cin.get();
-		return lexbuf[0];
+		token = c;
+		c = advance();
+		break;
 
 
 	    /* Check for '/' or a comment */
 
 	    case '/':
-		c = cin.get();
+		c = advance();
 
 		if (c == '*') {
 		    do {
-			while (c != '*' && !cin.eof()) {
+			while (c != '*' && c != EOF) {
 			    if (c == '\n')
 				lineno ++;
 
-			    c = cin.get();
+			    c = advance();
 			}
 
-			c = cin.get();
-		    } while (c != '/' && !cin.eof());
+			c = advance();
+		    } while (c != '/' && c != EOF);
 
-		    c = cin.get();
-		    break;
+		    c = advance();
+		    continue;
 
 		} else
-		    return '/';
+		    token = '/';
+
+		break;
 
 
 	    /* Check for a string literal */
@@ -310,18 +544,17 @@ int lexan(string &lexbuf)
 	    case '"':
 		do {
 		    p = c;
-		    c = cin.get();
-		    lexbuf += c;
+		    c = advance();
 
 		    if (c == '\n')
 			lineno ++;
 
-		} while (p == '\\' || (c != '"' && c != '\n' && !cin.eof()));
+		} while (p == '\\' || (c != '"' && c != '\n' && c != EOF));
 
-		if (c == '\n' || cin.eof())
+		if (c == '\n' || c == EOF)
 		    report("prematured end of string literal");
 		else {
-		    parseString(lexbuf, invalid, overflow);
+		    parseString(string(start, cursor + 1), invalid, overflow);
 
 		    if (invalid)
 			report("unknown escape sequence in string literal");
@@ -329,8 +562,9 @@ int lexan(string &lexbuf)
 			report("escape sequence out of range in string literal");
 		}
 
-		c = cin.get();
-		return STRING;
+		c = advance();
+		token = STRING;
+		break;
 
 
 	    /* Handle EOF here as well */
@@ -342,11 +576,16 @@ int lexan(string &lexbuf)
 	    /* Everything else is illegal */
 
 	    default:
-		c = cin.get();
-		return ERROR;
+		c = advance();
+		token = ERROR;
+		break;
 	    }
+
+	    lexeme.length = cursor - start;
+	    return token;
 	}
     }
 
+    lexeme.length = 0;
     return DONE;
 }
@@ -8,10 +8,21 @@
 # ifndef LEXER_H
 # define LEXER_H
 # include <string>
+# include "Atom.h"
 
 extern int lineno, numerrors;
 
-int lexan(std::string &lexbuf);
+struct Lexeme {
+    const char *text;
+    unsigned length;
+    Atom atom;
+
+    std::string str() const;
+};
+
+bool openInput(const std::string &path = "");
+void releaseInput();
+int lexan(Lexeme &lexeme);
 void report(const std::string &str, const std::string &arg = "");
 
 # endif /* LEXER_H */
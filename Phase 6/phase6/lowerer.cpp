@@ -0,0 +1,805 @@
+/*
+ * File:	lowerer.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		translating the abstract syntax tree of a function into
+ *		the intermediate representation.
+ *
+ *		The translation mirrors the code generator: expressions
+ *		are evaluated in the same order, and the statements use
+ *		the same labels to test and jump.  Each label names a
+ *		basic block, and every conditional jump starts a new block
+ *		for the code that follows it.  The procedure being built
+ *		and the block being added to are local to the thread, so
+ *		functions can be translated in parallel.
+ */
+
+# include <cassert>
+# include <cstdlib>
+# include "Tree.h"
+# include "IR.h"
+# include "machine.h"
+
+using namespace std;
+
+static thread_local Procedure *procedure;
+static thread_local BasicBlock *current;
+static thread_local vector<BasicBlock *> blocks;
+static thread_local unsigned depth;
+
+
+/*
+ * Function:	block (private)
+ *
+ * Description:	Return the basic block named by the given label, creating
+ *		it if necessary.
+ */
+
+static BasicBlock *block(const Label &label)
+{
+    if (blocks.size() <= label.number())
+	blocks.resize(label.number() + 1);
+
+    if (blocks[label.number()] == nullptr)
+	blocks[label.number()] = new BasicBlock(label);
+
+    return blocks[label.number()];
+}
+
+
+/*
+ * Function:	emit (private)
+ *
+ * Description:	Add a new instruction with the given opcode to the current
+ *		block, with a new temporary as its destination if it has a
+ *		result.
+ */
+
+static Instruction *emit(Opcode opcode, bool result = false)
+{
+    Instruction *insn = new Instruction(opcode, result ? procedure->temp() : 0);
+
+    current->_insns.push_back(insn);
+    return insn;
+}
+
+
+/*
+ * Function:	jump (private)
+ *
+ * Description:	End the current block with a jump to the given block.
+ */
+
+static void jump(BasicBlock *target)
+{
+    emit(JMP)->_targets.push_back(target);
+}
+
+
+/*
+ * Function:	start (private)
+ *
+ * Description:	Start adding instructions to the given block, which is
+ *		nested as deeply as the loops being lowered.  If the
+ *		current block has not already been ended, then it simply
+ *		falls through into the new one.
+ */
+
+static void start(BasicBlock *next)
+{
+    if (current != nullptr && current->terminator() == nullptr)
+	jump(next);
+
+    next->_depth = depth;
+    procedure->_blocks.push_back(next);
+    current = next;
+}
+
+
+/*
+ * Function:	branch (private)
+ *
+ * Description:	End the current block by comparing two temporaries and
+ *		jumping to the given label if the condition holds, and
+ *		start a new block for the code that follows.
+ */
+
+static void branch(Opcode condition, Temp left, Temp right, const Label &label)
+{
+    Label next;
+    Instruction *insn = emit(BR);
+
+
+    insn->_condition = condition;
+    insn->_uses = {left, right};
+    insn->_targets = {block(label), block(next)};
+    start(block(next));
+}
+
+
+/*
+ * Function:	constant (private)
+ *
+ * Description:	Return a new temporary holding the given constant.
+ */
+
+static Temp constant(int value)
+{
+    Instruction *insn = emit(CONSTANT, true);
+
+    insn->_value = value;
+    return insn->_def;
+}
+
+
+/*
+ * Function:	compute (private)
+ *
+ * Description:	Return a new temporary holding the result of applying the
+ *		given operation to the values of the two expressions.
+ */
+
+static Temp compute(Opcode opcode, Expression *left, Expression *right)
+{
+    Temp t1 = left->lower();
+    Temp t2 = right->lower();
+    Instruction *insn = emit(opcode, true);
+
+    insn->_uses = {t1, t2};
+    return insn->_def;
+}
+
+
+/*
+ * Function:	join (private)
+ *
+ * Description:	Return a new temporary holding the value of a logical
+ *		expression whose code has already jumped to the given
+ *		label if the result is the opposite of the given value,
+ *		and otherwise has fallen through to the current block.
+ */
+
+static Temp join(const Label &label, bool value)
+{
+    Label exit;
+    Temp t1, t2;
+    BasicBlock *b1, *b2;
+    Instruction *phi;
+
+
+    t1 = constant(value);
+    b1 = current;
+    jump(block(exit));
+
+    start(block(label));
+    t2 = constant(!value);
+    b2 = current;
+    start(block(exit));
+
+    phi = emit(PHI, true);
+    phi->_uses = {t1, t2};
+    phi->_targets = {b1, b2};
+    return phi->_def;
+}
+
+
+/*
+ * Function:	Expression::lower
+ *
+ * Description:	Every expression that can be evaluated overrides this
+ *		function, so this should never be called.
+ */
+
+Temp Expression::lower()
+{
+    assert(0);
+    return 0;
+}
+
+
+/*
+ * Function:	Expression::lowerAddress
+ *
+ * Description:	Only identifiers, dereferences, and strings have addresses,
+ *		so this should never be called.
+ */
+
+Temp Expression::lowerAddress()
+{
+    assert(0);
+    return 0;
+}
+
+
+/*
+ * Function:	Expression::lowerTest
+ *
+ * Description:	Test the value of an expression against zero and jump to
+ *		the label if the result is as given.
+ */
+
+void Expression::lowerTest(const Label &label, bool ifTrue)
+{
+    Temp t1 = lower();
+    Temp t2 = constant(0);
+
+    branch(ifTrue ? NE : EQ, t1, t2, label);
+}
+
+
+/*
+ * Function:	Identifier::lower
+ *
+ * Description:	Read the value of a variable.  An array is never read
+ *		as a whole, so we use its address instead.
+ */
+
+Temp Identifier::lower()
+{
+    Instruction *insn;
+
+
+    if (_symbol->type().isArray())
+	return lowerAddress();
+
+    insn = emit(GET, true);
+    insn->_symbol = _symbol;
+    insn->_size = _type.size();
+    return insn->_def;
+}
+
+
+/*
+ * Function:	Identifier::lowerAddress
+ *
+ * Description:	Compute the address of a variable.
+ */
+
+Temp Identifier::lowerAddress()
+{
+    Instruction *insn = emit(ADDRESS, true);
+
+    insn->_symbol = _symbol;
+    return insn->_def;
+}
+
+
+/*
+ * Function:	Number::lower
+ *
+ * Description:	Return the value of an integer literal.
+ */
+
+Temp Number::lower()
+{
+    return constant(strtoul(_value.c_str(), NULL, 0));
+}
+
+
+/*
+ * Function:	Number::lowerTest
+ *
+ * Description:	Test a number, which is known now: either we always jump to
+ *		the label or we never do.  Anything following an
+ *		unconditional jump starts an unreachable block.
+ */
+
+void Number::lowerTest(const Label &label, bool ifTrue)
+{
+    unsigned value;
+    Label next;
+
+
+    isNumber(value);
+
+    if ((value != 0) == ifTrue) {
+	jump(block(label));
+	start(block(next));
+    }
+}
+
+
+/*
+ * Function:	String::lower
+ *
+ * Description:	A string literal is an array, so its value is its address.
+ */
+
+Temp String::lower()
+{
+    return lowerAddress();
+}
+
+
+/*
+ * Function:	String::lowerAddress
+ *
+ * Description:	Compute the address of a string literal.
+ */
+
+Temp String::lowerAddress()
+{
+    Instruction *insn = emit(ADDRESS, true);
+
+    insn->_string = this;
+    return insn->_def;
+}
+
+
+/*
+ * Function:	Call::lower
+ *
+ * Description:	Evaluate the arguments, last to first as the generator
+ *		does, and then call the function.
+ */
+
+Temp Call::lower()
+{
+    vector<Temp> args(_args.size());
+    Instruction *insn;
+
+
+    for (int i = _args.size() - 1; i >= 0; i --)
+	args[i] = _args[i]->lower();
+
+    insn = emit(CALL, true);
+    insn->_symbol = _id;
+    insn->_uses = args;
+    return insn->_def;
+}
+
+
+/*
+ * Function:	Not::lower
+ *
+ * Description:	A logical negation compares its operand with zero.
+ */
+
+Temp Not::lower()
+{
+    Temp t1 = _expr->lower();
+    Temp t2 = constant(0);
+    Instruction *insn = emit(EQ, true);
+
+    insn->_uses = {t1, t2};
+    return insn->_def;
+}
+
+
+/*
+ * Function:	Not::lowerTest
+ *
+ * Description:	Testing a logical negation is just testing its operand
+ *		for the opposite result.
+ */
+
+void Not::lowerTest(const Label &label, bool ifTrue)
+{
+    _expr->lowerTest(label, !ifTrue);
+}
+
+
+/*
+ * Function:	Negate::lower
+ *
+ * Description:	Negate the value of the operand.
+ */
+
+Temp Negate::lower()
+{
+    Temp t1 = _expr->lower();
+    Instruction *insn = emit(NEG, true);
+
+    insn->_uses = {t1};
+    return insn->_def;
+}
+
+
+/*
+ * Function:	Dereference::lower
+ *
+ * Description:	Load the value that the operand points to.
+ */
+
+Temp Dereference::lower()
+{
+    Temp t1 = _expr->lower();
+    Instruction *insn = emit(LOAD, true);
+
+    insn->_uses = {t1};
+    insn->_size = _type.size();
+    return insn->_def;
+}
+
+
+/*
+ * Function:	Dereference::lowerAddress
+ *
+ * Description:	The address of a dereference is just the pointer.
+ */
+
+Temp Dereference::lowerAddress()
+{
+    return _expr->lower();
+}
+
+
+/*
+ * Function:	Address::lower
+ *
+ * Description:	Compute the address of the operand.
+ */
+
+Temp Address::lower()
+{
+    return _expr->lowerAddress();
+}
+
+
+/*
+ * Function:	Cast::lower
+ *
+ * Description:	Characters are sign extended as they are read, so a cast
+ *		leaves the value unchanged.
+ */
+
+Temp Cast::lower()
+{
+    return _expr->lower();
+}
+
+
+/*
+ * Function:	Multiply::lower, etc.
+ *
+ * Description:	Compute an arithmetic operation on the two operands.
+ */
+
+Temp Multiply::lower()
+{
+    return compute(MUL, _left, _right);
+}
+
+Temp Divide::lower()
+{
+    return compute(DIVIDE, _left, _right);
+}
+
+Temp Remainder::lower()
+{
+    return compute(REMAINDER, _left, _right);
+}
+
+Temp Add::lower()
+{
+    return compute(ADD, _left, _right);
+}
+
+Temp Subtract::lower()
+{
+    return compute(SUB, _left, _right);
+}
+
+
+/*
+ * Function:	LessThan::lower, etc.
+ *
+ * Description:	Compute the result of comparing the two operands as
+ *		either zero or one.
+ */
+
+Temp LessThan::lower()
+{
+    return compute(LT, _left, _right);
+}
+
+Temp GreaterThan::lower()
+{
+    return compute(GT, _left, _right);
+}
+
+Temp LessOrEqual::lower()
+{
+    return compute(LE, _left, _right);
+}
+
+Temp GreaterOrEqual::lower()
+{
+    return compute(GE, _left, _right);
+}
+
+Temp Equal::lower()
+{
+    return compute(EQ, _left, _right);
+}
+
+Temp NotEqual::lower()
+{
+    return compute(NE, _left, _right);
+}
+
+
+/*
+ * Function:	LessThan::lowerTest, etc.
+ *
+ * Description:	Compare the two operands and jump to the label if the
+ *		result is as given.
+ */
+
+void LessThan::lowerTest(const Label &label, bool ifTrue)
+{
+    Temp t1 = _left->lower(), t2 = _right->lower();
+    branch(ifTrue ? LT : GE, t1, t2, label);
+}
+
+void GreaterThan::lowerTest(const Label &label, bool ifTrue)
+{
+    Temp t1 = _left->lower(), t2 = _right->lower();
+    branch(ifTrue ? GT : LE, t1, t2, label);
+}
+
+void LessOrEqual::lowerTest(const Label &label, bool ifTrue)
+{
+    Temp t1 = _left->lower(), t2 = _right->lower();
+    branch(ifTrue ? LE : GT, t1, t2, label);
+}
+
+void GreaterOrEqual::lowerTest(const Label &label, bool ifTrue)
+{
+    Temp t1 = _left->lower(), t2 = _right->lower();
+    branch(ifTrue ? GE : LT, t1, t2, label);
+}
+
+void Equal::lowerTest(const Label &label, bool ifTrue)
+{
+    Temp t1 = _left->lower(), t2 = _right->lower();
+    branch(ifTrue ? EQ : NE, t1, t2, label);
+}
+
+void NotEqual::lowerTest(const Label &label, bool ifTrue)
+{
+    Temp t1 = _left->lower(), t2 = _right->lower();
+    branch(ifTrue ? NE : EQ, t1, t2, label);
+}
+
+
+/*
+ * Function:	LogicalAnd::lowerTest
+ *
+ * Description:	Test a logical-and expression with short circuiting.
+ */
+
+void LogicalAnd::lowerTest(const Label &label, bool ifTrue)
+{
+    if (ifTrue) {
+	Label skip;
+	_left->lowerTest(skip, false);
+	_right->lowerTest(label, true);
+	start(block(skip));
+    } else {
+	_left->lowerTest(label, false);
+	_right->lowerTest(label, false);
+    }
+}
+
+
+/*
+ * Function:	LogicalOr::lowerTest
+ *
+ * Description:	Test a logical-or expression with short circuiting.
+ */
+
+void LogicalOr::lowerTest(const Label &label, bool ifTrue)
+{
+    if (ifTrue) {
+	_left->lowerTest(label, true);
+	_right->lowerTest(label, true);
+    } else {
+	Label skip;
+	_left->lowerTest(skip, true);
+	_right->lowerTest(label, false);
+	start(block(skip));
+    }
+}
+
+
+/*
+ * Function:	LogicalAnd::lower
+ *
+ * Description:	Compute the value of a logical-and expression, which is
+ *		one if both operands are true, and zero otherwise.
+ */
+
+Temp LogicalAnd::lower()
+{
+    Label zero;
+
+    lowerTest(zero, false);
+    return join(zero, true);
+}
+
+
+/*
+ * Function:	LogicalOr::lower
+ *
+ * Description:	Compute the value of a logical-or expression, which is
+ *		zero if both operands are false, and one otherwise.
+ */
+
+Temp LogicalOr::lower()
+{
+    Label one;
+
+    lowerTest(one, true);
+    return join(one, false);
+}
+
+
+/*
+ * Function:	Simple::lower
+ *
+ * Description:	Evaluate the expression of a simple statement.
+ */
+
+void Simple::lower()
+{
+    _expr->lower();
+}
+
+
+/*
+ * Function:	Assignment::lower
+ *
+ * Description:	Evaluate the right-hand side and store it into either the
+ *		variable or the location given by the left-hand side.
+ */
+
+void Assignment::lower()
+{
+    Expression *pointer;
+    const Symbol *symbol;
+    Instruction *insn;
+    Temp t1, t2;
+
+
+    t1 = _right->lower();
+
+    if (_left->isDereference(pointer)) {
+	t2 = pointer->lower();
+	insn = emit(STORE);
+	insn->_uses = {t2, t1};
+
+    } else {
+	assert(_left->isIdentifier(symbol));
+	insn = emit(PUT);
+	insn->_symbol = symbol;
+	insn->_uses = {t1};
+    }
+
+    insn->_size = _left->type().size();
+}
+
+
+/*
+ * Function:	Return::lower
+ *
+ * Description:	Return the value of the expression.  Any code after the
+ *		return goes into a new block, which will be unreachable
+ *		unless it is labeled.
+ */
+
+void Return::lower()
+{
+    Label next;
+
+    emit(RET)->_uses = {_expr->lower()};
+    start(block(next));
+}
+
+
+/*
+ * Function:	Block::lower
+ *
+ * Description:	Translate each statement of the block in turn.
+ */
+
+void Block::lower()
+{
+    for (auto stmt : _stmts)
+	stmt->lower();
+}
+
+
+/*
+ * Function:	While::lower
+ *
+ * Description:	Translate a while loop, testing at the top.
+ */
+
+void While::lower()
+{
+    Label loop, exit;
+
+    depth ++;
+    start(block(loop));
+    _expr->lowerTest(exit, false);
+    _stmt->lower();
+    jump(block(loop));
+    depth --;
+    start(block(exit));
+}
+
+
+/*
+ * Function:	For::lower
+ *
+ * Description:	Translate a for loop, testing at the top.
+ */
+
+void For::lower()
+{
+    Label loop, exit;
+
+    _init->lower();
+    depth ++;
+    start(block(loop));
+    _expr->lowerTest(exit, false);
+    _stmt->lower();
+    _incr->lower();
+    jump(block(loop));
+    depth --;
+    start(block(exit));
+}
+
+
+/*
+ * Function:	If::lower
+ *
+ * Description:	Translate an if-then or if-then-else statement.
+ */
+
+void If::lower()
+{
+    Label exit, elseL;
+
+    _expr->lowerTest(_elseStmt != nullptr ? elseL : exit, false);
+    _thenStmt->lower();
+
+    if (_elseStmt != nullptr) {
+	jump(block(exit));
+	start(block(elseL));
+	_elseStmt->lower();
+    }
+
+    start(block(exit));
+}
+
+
+/*
+ * Function:	Function::lower
+ *
+ * Description:	Translate a function into a new procedure.  The caller
+ *		is responsible for deleting the procedure.
+ */
+
+Procedure *Function::lower()
+{
+    Label entry;
+    Procedure *result;
+
+
+    procedure = result = new Procedure(_id);
+    current = nullptr;
+    blocks.clear();
+
+    start(block(entry));
+    _body->lower();
+
+    if (current->terminator() == nullptr)
+	emit(RET);
+
+    result->link();
+    procedure = nullptr;
+    current = nullptr;
+    return result;
+}
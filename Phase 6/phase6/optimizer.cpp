@@ -0,0 +1,1687 @@
+/*
+ * File:	optimizer.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		optimizing the intermediate representation of a procedure.
+ *
+ *		At -O1, the procedure is first put into static single
+ *		assignment (SSA) form.  Each local variable of type int
+ *		or pointer whose address is never taken is replaced by
+ *		temporaries, with phi instructions inserted at the
+ *		dominance frontiers of the blocks assigning to it, so
+ *		that every temporary has exactly one definition.  The
+ *		value of each such variable on entry is read from the
+ *		stack, so parameters keep working and uninitialized locals
+ *		behave as before.
+ *
+ *		Then sparse conditional constant propagation (SCCP) finds
+ *		every temporary whose value is constant and every branch
+ *		that can only go one way, assuming that code is
+ *		unreachable until shown otherwise.
+ *
+ *		Next, local value numbering finds the instructions in each
+ *		basic block that compute the same value as an earlier one
+ *		in that block, and replaces their results with the earlier
+ *		result.  Besides arithmetic, this includes loading from
+ *		memory not written since it was last loaded, and reading
+ *		a variable or memory location just written, in which case
+ *		the value written is used.  Any store or call is assumed
+ *		to write every location whose address is known, except
+ *		the locals whose address is never taken.
+ *
+ *		Then loop-invariant code motion finds the natural loop of
+ *		each jump back to a block dominating it, and moves the
+ *		instructions whose operands do not change in the loop to
+ *		a preheader ahead of it, as long as they cannot trap and
+ *		read no memory the loop may write.
+ *
+ *		After the code no longer needed is eliminated, induction
+ *		variables are strength reduced: an expression that changes
+ *		by a constant amount on each iteration, such as the address
+ *		of a[i], becomes a variable of its own that is incremented
+ *		by that amount.  A loop test then left as the only use of
+ *		the original counter is rewritten to test the new variable
+ *		instead (linear function test replacement).
+ *
+ *		Finally, aggressive dead code elimination (ADCE) assumes
+ *		that every instruction is dead unless it has a side
+ *		effect, or computes a value or a branch needed by one
+ *		that is live.  A branch that is not needed is replaced
+ *		by a jump to the nearest block after it that is.
+ *
+ *		Dominators and postdominators are computed using the
+ *		iterative algorithm of Cooper, Harvey, and Kennedy.
+ */
+
+# include <map>
+# include <set>
+# include <cassert>
+# include <tuple>
+# include <climits>
+# include <algorithm>
+# include <unordered_map>
+# include "IR.h"
+# include "Tree.h"
+# include "machine.h"
+
+using namespace std;
+
+typedef vector<vector<unsigned>> Graph;
+
+typedef tuple<Opcode, Temp, Temp, int, unsigned, const Symbol *, const String *> Key;
+
+enum Lattice {UNKNOWN, KNOWN, VARYING};
+
+struct Value {
+    Lattice state;
+    int constant;
+};
+
+struct Induction {
+    Temp init, next;
+    int step;
+};
+
+struct Affine {
+    Temp iv;
+    unsigned scale;
+    Temp base;
+    unsigned offset;
+};
+
+atomic<unsigned long> recomputations, forwarded, hoisted, reduced, replaced;
+
+
+/*
+ * Function:	number (private)
+ *
+ * Description:	Number the blocks of a procedure in order and build the
+ *		graph of their successors and predecessors in terms of
+ *		those numbers.  The numbers are indexed by label.
+ */
+
+static void number(Procedure *proc, vector<unsigned> &index, Graph &succs,
+		   Graph &preds)
+{
+    unsigned n = proc->_blocks.size();
+
+
+    index.clear();
+
+    for (unsigned i = 0; i < n; i ++) {
+	unsigned label = proc->_blocks[i]->_label.number();
+
+	if (index.size() <= label)
+	    index.resize(label + 1);
+
+	index[label] = i;
+    }
+
+    succs.assign(n, vector<unsigned>());
+    preds.assign(n, vector<unsigned>());
+
+    for (unsigned i = 0; i < n; i ++)
+	for (auto succ : proc->_blocks[i]->_succs) {
+	    succs[i].push_back(index[succ->_label.number()]);
+	    preds[index[succ->_label.number()]].push_back(i);
+	}
+}
+
+
+/*
+ * Function:	dominators (private)
+ *
+ * Description:	Return the immediate dominator of each node of a graph
+ *		with the given root.  The root is its own dominator, and
+ *		a node not reachable from the root has none, which is
+ *		indicated by the number of nodes.
+ */
+
+static vector<unsigned> dominators(const Graph &succs, const Graph &preds,
+				   unsigned root)
+{
+    unsigned n = succs.size(), none = n;
+    vector<unsigned> idom(n, none), order, rank(n, none);
+    vector<pair<unsigned, unsigned>> stack;
+    vector<bool> seen(n);
+    bool changed;
+
+
+    /* Find a postorder of the nodes reachable from the root. */
+
+    stack.push_back(make_pair(root, 0));
+    seen[root] = true;
+
+    while (!stack.empty()) {
+	unsigned node = stack.back().first, &next = stack.back().second;
+
+	if (next < succs[node].size()) {
+	    unsigned succ = succs[node][next ++];
+
+	    if (!seen[succ]) {
+		seen[succ] = true;
+		stack.push_back(make_pair(succ, 0));
+	    }
+
+	} else {
+	    rank[node] = order.size();
+	    order.push_back(node);
+	    stack.pop_back();
+	}
+    }
+
+
+    /* Iterate in reverse postorder until nothing changes. */
+
+    idom[root] = root;
+
+    do {
+	changed = false;
+
+	for (int i = order.size() - 2; i >= 0; i --) {
+	    unsigned node = order[i], result = none;
+
+	    for (auto pred : preds[node]) {
+		if (idom[pred] == none)
+		    continue;
+
+		if (result == none) {
+		    result = pred;
+		    continue;
+		}
+
+		unsigned a = pred, b = result;
+
+		while (a != b) {
+		    while (rank[a] < rank[b])
+			a = idom[a];
+
+		    while (rank[b] < rank[a])
+			b = idom[b];
+		}
+
+		result = a;
+	    }
+
+	    if (idom[node] != result) {
+		idom[node] = result;
+		changed = true;
+	    }
+	}
+    } while (changed);
+
+    return idom;
+}
+
+
+/*
+ * Function:	frontiers (private)
+ *
+ * Description:	Return the dominance frontier of each node of a graph,
+ *		given the immediate dominators.  A node not reachable from
+ *		the root is in the frontier of its predecessors.
+ */
+
+static Graph frontiers(const Graph &preds, const vector<unsigned> &idom)
+{
+    unsigned n = preds.size();
+    Graph df(n);
+
+
+    for (unsigned node = 0; node < n; node ++)
+	if (preds[node].size() >= 2 && idom[node] != n)
+	    for (auto runner : preds[node])
+		while (runner != idom[node]) {
+		    if (find(df[runner].begin(), df[runner].end(), node) == df[runner].end())
+			df[runner].push_back(node);
+
+		    if (runner == idom[runner] || idom[runner] == n)
+			break;
+
+		    runner = idom[runner];
+		}
+
+    return df;
+}
+
+
+/*
+ * Function:	rename (private)
+ *
+ * Description:	Rename the variables in a block and then in the blocks it
+ *		immediately dominates.  A read of a variable becomes an
+ *		alias for its current value, and a write makes a new value
+ *		current, so both are deleted.  The operands of the phis
+ *		in the successors are then filled in.
+ */
+
+static void rename(Procedure *proc, unsigned node, const Graph &children,
+		   const map<const Symbol *, unsigned> &variables,
+		   const unordered_map<Instruction *, unsigned> &phis,
+		   vector<vector<Temp>> &stacks, vector<Temp> &aliases)
+{
+    BasicBlock *block = proc->_blocks[node];
+    vector<Instruction *> kept;
+    vector<unsigned> pushed;
+
+
+    for (auto insn : block->_insns) {
+	auto var = insn->_symbol != nullptr ? variables.find(insn->_symbol) : variables.end();
+
+	if (insn->_opcode == PHI && phis.count(insn) > 0) {
+	    stacks[phis.at(insn)].push_back(insn->_def);
+	    pushed.push_back(phis.at(insn));
+	    kept.push_back(insn);
+
+	} else if (insn->_opcode == GET && var != variables.end()) {
+	    aliases[insn->_def] = stacks[var->second].back();
+	    delete insn;
+
+	} else if (insn->_opcode == PUT && var != variables.end()) {
+	    stacks[var->second].push_back(insn->_uses[0]);
+	    pushed.push_back(var->second);
+	    delete insn;
+
+	} else
+	    kept.push_back(insn);
+    }
+
+    block->_insns.swap(kept);
+
+    for (auto succ : block->_succs)
+	for (auto insn : succ->_insns)
+	    if (insn->_opcode == PHI && phis.count(insn) > 0)
+		for (unsigned i = 0; i < insn->_targets.size(); i ++)
+		    if (insn->_targets[i] == block)
+			insn->_uses[i] = stacks[phis.at(insn)].back();
+
+    for (auto child : children[node])
+	rename(proc, child, children, variables, phis, stacks, aliases);
+
+    for (auto var : pushed)
+	stacks[var].pop_back();
+}
+
+
+/*
+ * Function:	construct (private)
+ *
+ * Description:	Put a procedure into SSA form as described above.
+ */
+
+static void construct(Procedure *proc)
+{
+    map<const Symbol *, unsigned> variables;
+    set<const Symbol *> excluded;
+    unordered_map<Instruction *, unsigned> phis;
+    vector<vector<unsigned>> defs;
+    vector<vector<Temp>> stacks;
+    vector<Instruction *> initial;
+    vector<unsigned> index, idom;
+    vector<Temp> aliases;
+    Graph succs, preds, df, children;
+    BasicBlock *entry = proc->_blocks[0];
+
+
+    /* Find the variables that can be promoted. */
+
+    for (auto block : proc->_blocks)
+	for (auto insn : block->_insns)
+	    if (insn->_symbol != nullptr && insn->_symbol->_offset != 0) {
+		if (insn->_opcode == ADDRESS || insn->_size != SIZEOF_INT)
+		    excluded.insert(insn->_symbol);
+		else if (insn->_opcode == GET || insn->_opcode == PUT)
+		    variables.insert(make_pair(insn->_symbol, 0));
+	    }
+
+    for (auto symbol : excluded)
+	variables.erase(symbol);
+
+    if (variables.empty())
+	return;
+
+    for (auto &var : variables) {
+	var.second = defs.size();
+	defs.push_back(vector<unsigned>(1, 0));
+    }
+
+
+    /* Find the blocks writing each variable and the dominance frontiers. */
+
+    number(proc, index, succs, preds);
+    idom = dominators(succs, preds, 0);
+    df = frontiers(preds, idom);
+    children.resize(succs.size());
+
+    for (unsigned node = 1; node < idom.size(); node ++)
+	children[idom[node]].push_back(node);
+
+    for (unsigned node = 0; node < proc->_blocks.size(); node ++)
+	for (auto insn : proc->_blocks[node]->_insns)
+	    if (insn->_opcode == PUT && variables.count(insn->_symbol) > 0)
+		defs[variables[insn->_symbol]].push_back(node);
+
+
+    /* Insert phis at the iterated dominance frontiers. */
+
+    for (auto &var : variables) {
+	vector<unsigned> work = defs[var.second];
+	vector<bool> placed(succs.size()), queued(succs.size());
+
+	for (auto node : work)
+	    queued[node] = true;
+
+	while (!work.empty()) {
+	    unsigned node = work.back();
+	    work.pop_back();
+
+	    for (auto frontier : df[node])
+		if (!placed[frontier]) {
+		    BasicBlock *block = proc->_blocks[frontier];
+		    Instruction *phi = new Instruction(PHI, proc->temp());
+
+		    phi->_targets = block->_preds;
+		    phi->_uses.resize(block->_preds.size());
+		    block->_insns.insert(block->_insns.begin(), phi);
+		    phis[phi] = var.second;
+		    placed[frontier] = true;
+
+		    if (!queued[frontier]) {
+			queued[frontier] = true;
+			work.push_back(frontier);
+		    }
+		}
+	}
+    }
+
+
+    /* Read the value of each variable on entry and rename them all. */
+
+    stacks.resize(variables.size());
+
+    for (auto &var : variables) {
+	Instruction *get = new Instruction(GET, proc->temp());
+
+	get->_symbol = var.first;
+	get->_size = SIZEOF_INT;
+	initial.push_back(get);
+	stacks[var.second].push_back(get->_def);
+    }
+
+    aliases.assign(proc->_temps + 1, 0);
+    rename(proc, 0, children, variables, phis, stacks, aliases);
+    entry->_insns.insert(entry->_insns.begin(), initial.begin(), initial.end());
+
+    for (auto block : proc->_blocks)
+	for (auto insn : block->_insns)
+	    for (auto &t : insn->_uses)
+		while (aliases[t] != 0)
+		    t = aliases[t];
+}
+
+
+/*
+ * Function:	fold (private)
+ *
+ * Description:	Compute the result of an operation on constants, as the
+ *		machine would.  A division that would trap is not folded.
+ */
+
+static bool fold(Opcode opcode, int a, int b, int &result)
+{
+    unsigned x = a, y = b;
+
+
+    switch (opcode) {
+    case ADD: result = x + y; return true;
+    case SUB: result = x - y; return true;
+    case MUL: result = x * y; return true;
+    case NEG: result = -x; return true;
+    case EQ: result = a == b; return true;
+    case NE: result = a != b; return true;
+    case LT: result = a < b; return true;
+    case GT: result = a > b; return true;
+    case LE: result = a <= b; return true;
+    case GE: result = a >= b; return true;
+
+    case DIVIDE:
+    case REMAINDER:
+	if (b == 0 || (a == INT_MIN && b == -1))
+	    return false;
+
+	result = opcode == DIVIDE ? a / b : a % b;
+	return true;
+
+    default:
+	return false;
+    }
+}
+
+
+/*
+ * Function:	propagate (private)
+ *
+ * Description:	Perform sparse conditional constant propagation on a
+ *		procedure in SSA form.  Constant results are replaced by
+ *		constants, branches that only go one way by jumps, and
+ *		blocks never reached are deleted.
+ */
+
+static void propagate(Procedure *proc)
+{
+    vector<Value> values(proc->_temps + 1, Value {UNKNOWN, 0});
+    vector<vector<Instruction *>> users(proc->_temps + 1);
+    unordered_map<Instruction *, BasicBlock *> owner;
+    vector<pair<BasicBlock *, BasicBlock *>> flow;
+    set<pair<BasicBlock *, BasicBlock *>> executable;
+    set<BasicBlock *> reached;
+    vector<Instruction *> ssa;
+
+
+    for (auto block : proc->_blocks)
+	for (auto insn : block->_insns) {
+	    owner[insn] = block;
+
+	    for (auto t : insn->_uses)
+		users[t].push_back(insn);
+	}
+
+
+    /* Evaluate an instruction, lowering its value or adding edges. */
+
+    auto visit = [&](Instruction *insn) {
+	BasicBlock *block = owner[insn];
+	Value result = {VARYING, 0};
+	const vector<Temp> &uses = insn->_uses;
+
+
+	if (insn->_opcode == JMP) {
+	    flow.push_back(make_pair(block, insn->_targets[0]));
+	    return;
+	}
+
+	if (insn->_opcode == BR) {
+	    const Value &a = values[uses[0]], &b = values[uses[1]];
+	    int taken;
+
+	    if (a.state == VARYING || b.state == VARYING) {
+		flow.push_back(make_pair(block, insn->_targets[0]));
+		flow.push_back(make_pair(block, insn->_targets[1]));
+	    } else if (a.state == KNOWN && b.state == KNOWN) {
+		fold(insn->_condition, a.constant, b.constant, taken);
+		flow.push_back(make_pair(block, insn->_targets[taken ? 0 : 1]));
+	    }
+
+	    return;
+	}
+
+	if (insn->_def == 0)
+	    return;
+
+	if (insn->_opcode == CONSTANT)
+	    result = Value {KNOWN, insn->_value};
+
+	else if (insn->_opcode == PHI) {
+	    result.state = UNKNOWN;
+
+	    for (unsigned i = 0; i < uses.size(); i ++) {
+		const Value &v = values[uses[i]];
+
+		if (executable.count(make_pair(insn->_targets[i], block)) == 0 || v.state == UNKNOWN)
+		    continue;
+
+		if (v.state == VARYING || (result.state == KNOWN && result.constant != v.constant))
+		    result.state = VARYING;
+		else if (result.state == UNKNOWN)
+		    result = v;
+	    }
+
+	} else if (insn->_opcode == COPY)
+	    result = values[uses[0]];
+
+	else if (insn->isPure() || insn->_opcode == DIVIDE || insn->_opcode == REMAINDER) {
+	    if (insn->_opcode != GET && insn->_opcode != LOAD && insn->_opcode != ADDRESS) {
+		bool unknown = false, varying = false;
+
+		for (auto t : uses) {
+		    unknown = unknown || values[t].state == UNKNOWN;
+		    varying = varying || values[t].state == VARYING;
+		}
+
+		if (!varying && unknown)
+		    result.state = UNKNOWN;
+		else if (!varying) {
+		    int a = values[uses[0]].constant;
+		    int b = uses.size() > 1 ? values[uses[1]].constant : 0;
+
+		    if (fold(insn->_opcode, a, b, result.constant))
+			result.state = KNOWN;
+		}
+	    }
+	}
+
+	Value &old = values[insn->_def];
+
+	if (old.state != result.state || old.constant != result.constant) {
+	    old = result;
+	    ssa.insert(ssa.end(), users[insn->_def].begin(), users[insn->_def].end());
+	}
+    };
+
+
+    /* Propagate along the edges and the uses until nothing changes. */
+
+    flow.push_back(make_pair(nullptr, proc->_blocks[0]));
+
+    while (!flow.empty() || !ssa.empty()) {
+	if (!flow.empty()) {
+	    pair<BasicBlock *, BasicBlock *> edge = flow.back();
+	    flow.pop_back();
+
+	    if (executable.count(edge) > 0)
+		continue;
+
+	    executable.insert(edge);
+	    BasicBlock *block = edge.second;
+
+	    if (reached.count(block) == 0) {
+		reached.insert(block);
+
+		for (auto insn : block->_insns)
+		    visit(insn);
+	    } else
+		for (auto insn : block->_insns)
+		    if (insn->_opcode == PHI)
+			visit(insn);
+
+	} else {
+	    Instruction *insn = ssa.back();
+	    ssa.pop_back();
+
+	    if (reached.count(owner[insn]) > 0)
+		visit(insn);
+	}
+    }
+
+
+    /* Rewrite constants and branches that can only go one way.  A phi
+       rewritten as a constant is moved after the phis left in its
+       block, so that they still come first. */
+
+    for (auto block : proc->_blocks) {
+	if (reached.count(block) == 0)
+	    continue;
+
+	for (auto insn : block->_insns) {
+	    if (insn->_def != 0 && insn->_opcode != CONSTANT &&
+		    values[insn->_def].state == KNOWN) {
+		insn->_opcode = CONSTANT;
+		insn->_value = values[insn->_def].constant;
+		insn->_uses.clear();
+		insn->_targets.clear();
+		insn->_symbol = nullptr;
+
+	    } else if (insn->_opcode == BR) {
+		bool first = executable.count(make_pair(block, insn->_targets[0])) > 0;
+		bool second = executable.count(make_pair(block, insn->_targets[1])) > 0;
+
+		if (first != second) {
+		    insn->_opcode = JMP;
+		    insn->_uses.clear();
+		    insn->_targets = {insn->_targets[first ? 0 : 1]};
+		}
+	    }
+	}
+
+	stable_partition(block->_insns.begin(), block->_insns.end(),
+			 [](Instruction *insn) { return insn->_opcode == PHI; });
+    }
+
+    proc->link();
+}
+
+
+/*
+ * Function:	exposure (private)
+ *
+ * Description:	Return the variables of a procedure that may be written
+ *		by any store or call, and read by any load, which are the
+ *		globals and the locals whose address is taken.
+ */
+
+static set<const Symbol *> exposure(Procedure *proc)
+{
+    set<const Symbol *> exposed;
+
+
+    for (auto block : proc->_blocks)
+	for (auto insn : block->_insns)
+	    if (insn->_symbol != nullptr &&
+		    (insn->_symbol->_offset == 0 || insn->_opcode == ADDRESS))
+		exposed.insert(insn->_symbol);
+
+    return exposed;
+}
+
+
+/*
+ * Function:	key (private)
+ *
+ * Description:	Return the key under which the value of an instruction is
+ *		numbered, given the value number of each temporary.  The
+ *		operands of a commutative operation are put in order, and
+ *		those of a comparison are put in order by swapping the
+ *		comparison if need be, so that a + b and b + a are the
+ *		same value.
+ */
+
+static Key key(const Instruction *insn, const vector<Temp> &numbers)
+{
+    Opcode opcode = insn->_opcode;
+    Temp a = insn->_uses.size() > 0 ? numbers[insn->_uses[0]] : 0;
+    Temp b = insn->_uses.size() > 1 ? numbers[insn->_uses[1]] : 0;
+
+
+    if (a > b && (opcode == ADD || opcode == MUL || (opcode >= EQ && opcode <= GE))) {
+	swap(a, b);
+	opcode = ::swap(opcode);
+    }
+
+    return Key(opcode, a, b, insn->_value, insn->_size, insn->_symbol, insn->_string);
+}
+
+
+/*
+ * Function:	reuse (private)
+ *
+ * Description:	Perform local value numbering on a procedure in SSA form.
+ *		Since every temporary is defined once, an instruction
+ *		computing a value already computed earlier in its block
+ *		can simply be deleted, and its result replaced everywhere
+ *		by the earlier one.  Constants, addresses, and reads of
+ *		variables not just written are kept, but numbered the same
+ *		as the earlier value, since doing any of them again takes
+ *		at most a single instruction, which is no more than
+ *		reloading the value if keeping it around causes it to be
+ *		spilled.
+ */
+
+static void reuse(Procedure *proc)
+{
+    vector<Temp> numbers(proc->_temps + 1), aliases(proc->_temps + 1);
+    set<const Symbol *> exposed = exposure(proc);
+
+
+    for (Temp t = 0; t <= proc->_temps; t ++)
+	numbers[t] = t;
+
+
+    /* Number the values of each block, remembering for each whether it
+       was written to memory rather than computed. */
+
+    for (auto block : proc->_blocks) {
+	map<Key, pair<Temp, bool>> values;
+	vector<Instruction *> kept;
+
+	auto kill = [&](const Symbol *symbol, bool loads) {
+	    for (auto it = values.begin(); it != values.end(); ) {
+		Opcode opcode = get<0>(it->first);
+		const Symbol *other = get<5>(it->first);
+
+		if ((opcode == LOAD && loads) || (opcode == GET && (other == symbol ||
+			(symbol == nullptr && exposed.count(other) > 0))))
+		    it = values.erase(it);
+		else
+		    ++ it;
+	    }
+	};
+
+	for (auto insn : block->_insns) {
+	    Opcode opcode = insn->_opcode;
+
+	    for (auto &t : insn->_uses)
+		if (aliases[t] != 0)
+		    t = aliases[t];
+
+	    if (opcode == STORE || opcode == CALL) {
+		kill(nullptr, true);
+
+		if (opcode == STORE && insn->_size == SIZEOF_INT) {
+		    Key load(LOAD, numbers[insn->_uses[0]], 0, 0, insn->_size, nullptr, nullptr);
+		    values[load] = make_pair(insn->_uses[1], true);
+		}
+
+	    } else if (opcode == PUT) {
+		kill(insn->_symbol, exposed.count(insn->_symbol) > 0);
+
+		if (insn->_size == SIZEOF_INT) {
+		    Key get(GET, 0, 0, 0, insn->_size, insn->_symbol, nullptr);
+		    values[get] = make_pair(insn->_uses[0], true);
+		}
+
+	    } else if (insn->_def != 0 && opcode != COPY && opcode != PHI) {
+		Key k = key(insn, numbers);
+		auto it = values.find(k);
+
+		if (it == values.end())
+		    values[k] = make_pair(insn->_def, false);
+
+		else if (!it->second.second &&
+			(opcode == CONSTANT || opcode == ADDRESS || opcode == GET))
+		    numbers[insn->_def] = numbers[it->second.first];
+
+		else {
+		    aliases[insn->_def] = it->second.first;
+
+		    if (it->second.second)
+			forwarded ++;
+		    else
+			recomputations ++;
+
+		    delete insn;
+		    continue;
+		}
+	    }
+
+	    kept.push_back(insn);
+	}
+
+	block->_insns.swap(kept);
+    }
+
+    for (auto block : proc->_blocks)
+	for (auto insn : block->_insns)
+	    for (auto &t : insn->_uses)
+		while (aliases[t] != 0)
+		    t = aliases[t];
+}
+
+
+/*
+ * Function:	dominates (private)
+ *
+ * Description:	Return whether one node dominates another, given the
+ *		immediate dominators.
+ */
+
+static bool dominates(const vector<unsigned> &idom, unsigned a, unsigned b)
+{
+    while (b != a && b < idom.size() && idom[b] != b)
+	b = idom[b];
+
+    return a == b;
+}
+
+
+/*
+ * Function:	preheaders (private)
+ *
+ * Description:	Give each loop header entered from a single block a
+ *		preheader, which is a block that does nothing but jump to
+ *		the header and is its only predecessor outside the loop.
+ *		A block entering the loop by a jump is already one, so a
+ *		new block is needed only if it branches into the loop.
+ */
+
+static void preheaders(Procedure *proc)
+{
+    vector<BasicBlock *> blocks;
+    vector<unsigned> index, idom;
+    Graph succs, preds;
+
+
+    number(proc, index, succs, preds);
+    idom = dominators(succs, preds, 0);
+
+    for (unsigned node = 0; node < succs.size(); node ++) {
+	BasicBlock *header = proc->_blocks[node], *entry = nullptr;
+	unsigned entries = 0;
+	bool loop = false;
+
+	for (auto pred : preds[node])
+	    if (dominates(idom, node, pred))
+		loop = true;
+	    else {
+		entry = proc->_blocks[pred];
+		entries ++;
+	    }
+
+	if (loop && entries == 1 && entry->terminator()->_opcode != JMP) {
+	    BasicBlock *block = new BasicBlock(Label());
+	    Instruction *insn = new Instruction(JMP);
+	    vector<BasicBlock *> &targets = entry->terminator()->_targets;
+
+	    insn->_targets.push_back(header);
+	    block->_insns.push_back(insn);
+	    block->_depth = entry->_depth;
+	    replace(targets.begin(), targets.end(), header, block);
+
+	    for (auto phi : header->_insns)
+		if (phi->_opcode == PHI)
+		    replace(phi->_targets.begin(), phi->_targets.end(), entry, block);
+
+	    blocks.push_back(block);
+	}
+
+	blocks.push_back(header);
+    }
+
+    proc->_blocks.swap(blocks);
+    proc->link();
+}
+
+
+/*
+ * Function:	loops (private)
+ *
+ * Description:	Return the natural loop of each loop header, which is the
+ *		header followed by every block that reaches a jump back to
+ *		it without passing through it.  The loops are returned
+ *		from the innermost out.
+ */
+
+static Graph loops(const Graph &preds, const vector<unsigned> &idom)
+{
+    unsigned n = preds.size();
+    Graph result;
+
+
+    for (unsigned node = 0; node < n; node ++) {
+	vector<unsigned> body(1, node), work;
+	vector<bool> inside(n);
+
+	for (auto pred : preds[node])
+	    if (dominates(idom, node, pred))
+		work.push_back(pred);
+
+	if (work.empty())
+	    continue;
+
+	inside[node] = true;
+
+	while (!work.empty()) {
+	    unsigned next = work.back();
+	    work.pop_back();
+
+	    if (!inside[next]) {
+		inside[next] = true;
+		body.push_back(next);
+		work.insert(work.end(), preds[next].begin(), preds[next].end());
+	    }
+	}
+
+	result.push_back(body);
+    }
+
+    stable_sort(result.begin(), result.end(),
+	[](const vector<unsigned> &a, const vector<unsigned> &b) {
+	    return a.size() < b.size();
+	});
+
+    return result;
+}
+
+
+/*
+ * Function:	preheader (private)
+ *
+ * Description:	Return the preheader of a loop, or null if it has none.
+ */
+
+static BasicBlock *preheader(Procedure *proc, const vector<unsigned> &body,
+			     const Graph &preds, const vector<bool> &inside)
+{
+    BasicBlock *result = nullptr;
+
+
+    for (auto pred : preds[body[0]])
+	if (!inside[pred]) {
+	    if (result != nullptr)
+		return nullptr;
+
+	    result = proc->_blocks[pred];
+	}
+
+    return result != nullptr && result->_succs.size() == 1 ? result : nullptr;
+}
+
+
+/*
+ * Function:	hoist (private)
+ *
+ * Description:	Perform loop-invariant code motion on a procedure in SSA
+ *		form.  An instruction in a loop whose operands are all
+ *		computed outside the loop is moved to the preheader, as
+ *		long as it cannot trap and reads no memory that the loop
+ *		may write.  A load might still trap if the loop never
+ *		runs, so it is only moved if it is run whenever the loop
+ *		is, which is when it dominates every way out of the loop.
+ *		The loops are visited from the innermost out, so that an
+ *		instruction may be moved out of several loops at once.
+ */
+
+static void hoist(Procedure *proc)
+{
+    set<const Symbol *> exposed = exposure(proc);
+    vector<unsigned> index, idom;
+    Graph succs, preds;
+    unsigned n;
+
+
+    preheaders(proc);
+    number(proc, index, succs, preds);
+    idom = dominators(succs, preds, 0);
+    n = succs.size();
+
+    /* Move the invariant instructions of each loop until none are left,
+       since moving one may make others invariant. */
+
+    for (auto &body : loops(preds, idom)) {
+	vector<bool> inside(n), varying(proc->_temps + 1);
+	vector<unsigned> exits;
+	set<const Symbol *> written;
+	BasicBlock *entry;
+	bool clobbered = false, changed;
+
+	for (auto node : body)
+	    inside[node] = true;
+
+	if ((entry = preheader(proc, body, preds, inside)) == nullptr)
+	    continue;
+
+	for (auto node : body) {
+	    for (auto insn : proc->_blocks[node]->_insns) {
+		if (insn->_opcode == STORE || insn->_opcode == CALL)
+		    clobbered = true;
+		else if (insn->_opcode == PUT)
+		    written.insert(insn->_symbol);
+
+		if (insn->_def != 0)
+		    varying[insn->_def] = true;
+	    }
+
+	    for (auto succ : succs[node])
+		if (!inside[succ])
+		    exits.push_back(node);
+	}
+
+	for (auto symbol : written)
+	    clobbered = clobbered || exposed.count(symbol) > 0;
+
+	auto invariant = [&](unsigned node, Instruction *insn) {
+	    switch (insn->_opcode) {
+	    case GET:
+		if (written.count(insn->_symbol) > 0 ||
+			(clobbered && exposed.count(insn->_symbol) > 0))
+		    return false;
+
+		break;
+
+	    case LOAD:
+		if (clobbered)
+		    return false;
+
+		for (auto exit : exits)
+		    if (!dominates(idom, node, exit))
+			return false;
+
+		break;
+
+	    case CONSTANT: case ADDRESS: case ADD: case SUB: case MUL:
+	    case NEG: case EQ: case NE: case LT: case GT: case LE: case GE:
+		break;
+
+	    default:
+		return false;
+	    }
+
+	    for (auto t : insn->_uses)
+		if (varying[t])
+		    return false;
+
+	    return true;
+	};
+
+	do {
+	    changed = false;
+
+	    for (auto node : body) {
+		BasicBlock *block = proc->_blocks[node];
+		vector<Instruction *> kept;
+
+		for (auto insn : block->_insns)
+		    if (invariant(node, insn)) {
+			entry->_insns.insert(entry->_insns.end() - 1, insn);
+			varying[insn->_def] = false;
+			changed = true;
+
+			if (insn->_opcode != CONSTANT)
+			    hoisted ++;
+		    } else
+			kept.push_back(insn);
+
+		block->_insns.swap(kept);
+	    }
+	} while (changed);
+    }
+}
+
+
+/*
+ * Function:	append (private)
+ *
+ * Description:	Add a new instruction computing a value to the end of a
+ *		block, just before its terminator, and return its result.
+ */
+
+static Temp append(Procedure *proc, BasicBlock *block, Opcode opcode,
+		   const vector<Temp> &uses, int value = 0)
+{
+    Instruction *insn = new Instruction(opcode, proc->temp());
+
+
+    insn->_uses = uses;
+    insn->_value = value;
+    block->_insns.insert(block->_insns.end() - 1, insn);
+    return insn->_def;
+}
+
+
+/*
+ * Function:	reduce (private)
+ *
+ * Description:	Perform strength reduction and linear function test
+ *		replacement on a procedure in SSA form whose invariants
+ *		have been hoisted.  A basic induction variable is a phi in
+ *		a loop header that is incremented by a constant on each
+ *		iteration, and an expression derived from one has the form
+ *		i * scale + base + offset, where the scale and offset are
+ *		constants and the base is invariant.  Each derived value
+ *		used inside the loop other than to derive another, such as
+ *		the address of an array element, is replaced by a new
+ *		induction variable of its own, which starts at the value
+ *		of the expression and is incremented by the scale times
+ *		the step.
+ *
+ *		If the loop test is then the only use of a basic
+ *		induction variable counting up by one, and one of the new
+ *		variables is the address of a load or store done on every
+ *		iteration, the test is rewritten to compare that address
+ *		for equality against its final value, so that the
+ *		original variable is no longer needed.  Since the address
+ *		is used on every iteration, it cannot wrap around before
+ *		reaching the final value, and the final value is computed
+ *		so that the loop is not entered if the original test would
+ *		have failed at first.
+ */
+
+static void reduce(Procedure *proc)
+{
+    vector<unsigned> index, idom;
+    Graph succs, preds;
+    unsigned n;
+
+
+    number(proc, index, succs, preds);
+    idom = dominators(succs, preds, 0);
+    n = succs.size();
+
+    for (auto &body : loops(preds, idom)) {
+	vector<bool> inside(n + 1);
+	vector<Instruction *> defs(proc->_temps + 1), added;
+	vector<unsigned> owner(proc->_temps + 1, n), counts(proc->_temps + 1);
+	vector<pair<Instruction *, Instruction *>> increments;
+	map<Temp, Induction> ivs;
+	map<Temp, Affine> forms;
+	map<tuple<Temp, unsigned, Temp, unsigned>, pair<Temp, Temp>> pointers;
+	BasicBlock *header = proc->_blocks[body[0]], *entry, *latch = nullptr;
+	Instruction *test = header->terminator();
+	bool changed;
+
+	for (auto node : body)
+	    inside[node] = true;
+
+	for (auto pred : preds[body[0]])
+	    if (inside[pred])
+		latch = latch == nullptr ? proc->_blocks[pred] : header;
+
+	entry = preheader(proc, body, preds, inside);
+
+	if (entry == nullptr || latch == header)
+	    continue;
+
+	for (unsigned node = 0; node < n; node ++)
+	    for (auto insn : proc->_blocks[node]->_insns)
+		if (insn->_def != 0) {
+		    defs[insn->_def] = insn;
+		    owner[insn->_def] = node;
+		}
+
+	auto constant = [&](Temp t) {
+	    return defs[t] != nullptr && defs[t]->_opcode == CONSTANT;
+	};
+
+
+	/* Find the basic induction variables. */
+
+	for (auto phi : header->_insns) {
+	    if (phi->_opcode != PHI)
+		break;
+
+	    if (phi->_uses.size() != 2)
+		continue;
+
+	    unsigned from = phi->_targets[0] == entry ? 0 : 1;
+	    Instruction *insn = defs[phi->_uses[1 - from]];
+
+	    if (insn == nullptr || !inside[owner[insn->_def]] || insn->_uses.size() != 2)
+		continue;
+
+	    Temp a = insn->_uses[0], b = insn->_uses[1];
+
+	    if (insn->_opcode == ADD && a == phi->_def && constant(b))
+		ivs[phi->_def] = Induction {phi->_uses[from], insn->_def, defs[b]->_value};
+	    else if (insn->_opcode == ADD && b == phi->_def && constant(a))
+		ivs[phi->_def] = Induction {phi->_uses[from], insn->_def, defs[a]->_value};
+	    else if (insn->_opcode == SUB && a == phi->_def && constant(b))
+		ivs[phi->_def] = Induction {phi->_uses[from], insn->_def, -defs[b]->_value};
+	    else
+		continue;
+
+	    forms[phi->_def] = Affine {phi->_def, 1, 0, 0};
+	}
+
+	if (ivs.empty())
+	    continue;
+
+
+	/* Find the expressions derived from them, until no more are found,
+	   using unsigned arithmetic since it wraps around as the machine
+	   does. */
+
+	do {
+	    changed = false;
+
+	    for (auto node : body)
+		for (auto insn : proc->_blocks[node]->_insns) {
+		    if (insn->_def == 0 || forms.count(insn->_def) > 0 || insn->_uses.size() != 2)
+			continue;
+
+		    Temp a = insn->_uses[0], b = insn->_uses[1];
+		    Affine form;
+
+		    if (insn->_opcode != SUB && forms.count(a) == 0)
+			swap(a, b);
+
+		    if (forms.count(a) == 0)
+			continue;
+
+		    form = forms[a];
+
+		    if (insn->_opcode == MUL && constant(b) && form.base == 0) {
+			form.scale *= defs[b]->_value;
+			form.offset *= defs[b]->_value;
+		    } else if (insn->_opcode == ADD && constant(b))
+			form.offset += defs[b]->_value;
+		    else if (insn->_opcode == ADD && !inside[owner[b]] && form.base == 0)
+			form.base = b;
+		    else if (insn->_opcode == SUB && constant(b))
+			form.offset -= defs[b]->_value;
+		    else
+			continue;
+
+		    forms[insn->_def] = form;
+		    changed = true;
+		}
+	} while (changed);
+
+
+	/* Replace each derived value worth reducing that is used by
+	   anything else in the loop with a new induction variable. */
+
+	auto pointer = [&](const Affine &form) {
+	    auto key = make_tuple(form.iv, form.scale, form.base, form.offset);
+
+	    if (pointers.count(key) > 0)
+		return pointers[key].first;
+
+	    const Induction &iv = ivs[form.iv];
+	    Instruction *phi = new Instruction(PHI, proc->temp());
+	    Instruction *step = new Instruction(CONSTANT, proc->temp());
+	    Instruction *next = new Instruction(ADD, proc->temp());
+	    Temp start;
+
+	    if (constant(iv.init)) {
+		unsigned value = form.scale * defs[iv.init]->_value + form.offset;
+
+		if (form.base == 0)
+		    start = append(proc, entry, CONSTANT, {}, value);
+		else if (value == 0)
+		    start = form.base;
+		else
+		    start = append(proc, entry, ADD,
+			{form.base, append(proc, entry, CONSTANT, {}, value)});
+
+	    } else {
+		start = append(proc, entry, CONSTANT, {}, form.scale);
+		start = append(proc, entry, MUL, {iv.init, start});
+
+		if (form.base != 0)
+		    start = append(proc, entry, ADD, {start, form.base});
+
+		if (form.offset != 0)
+		    start = append(proc, entry, ADD,
+			{start, append(proc, entry, CONSTANT, {}, form.offset)});
+	    }
+
+	    step->_value = form.scale * iv.step;
+	    next->_uses = {phi->_def, step->_def};
+	    phi->_uses = {start, next->_def};
+	    phi->_targets = {entry, latch};
+	    added.push_back(phi);
+	    increments.push_back(make_pair(defs[iv.next], step));
+	    increments.push_back(make_pair(step, next));
+	    pointers[key] = make_pair(phi->_def, start);
+	    reduced ++;
+	    return phi->_def;
+	};
+
+	for (auto node : body)
+	    for (auto insn : proc->_blocks[node]->_insns) {
+		bool memory = insn->_opcode == LOAD || insn->_opcode == STORE;
+
+		if (insn->_def != 0 && forms.count(insn->_def) > 0)
+		    continue;
+
+		for (unsigned k = 0; k < insn->_uses.size(); k ++) {
+		    Temp &t = insn->_uses[k];
+
+		    if (forms.count(t) > 0 && forms[t].scale != 0 && (forms[t].scale
+			    != 1 || (forms[t].base != 0 && memory && k == 0)))
+			t = pointer(forms[t]);
+		}
+	    }
+
+	header->_insns.insert(header->_insns.begin(), added.begin(), added.end());
+
+	for (auto &inc : increments) {
+	    for (auto node : body) {
+		vector<Instruction *> &insns = proc->_blocks[node]->_insns;
+		auto it = find(insns.begin(), insns.end(), inc.first);
+
+		if (it != insns.end()) {
+		    insns.insert(it + 1, inc.second);
+		    break;
+		}
+	    }
+	}
+
+
+	/* Delete the derived values no longer used, and count the uses of
+	   the rest. */
+
+	for (auto block : proc->_blocks)
+	    for (auto insn : block->_insns)
+		for (auto t : insn->_uses)
+		    if (t < counts.size())
+			counts[t] ++;
+
+	do {
+	    changed = false;
+
+	    for (auto node : body) {
+		BasicBlock *block = proc->_blocks[node];
+		vector<Instruction *> kept;
+
+		for (auto insn : block->_insns)
+		    if (insn->_def < counts.size() && counts[insn->_def] == 0 &&
+			    forms.count(insn->_def) > 0 && ivs.count(insn->_def) == 0) {
+			for (auto t : insn->_uses)
+			    if (t < counts.size())
+				counts[t] --;
+
+			delete insn;
+			changed = true;
+		    } else
+			kept.push_back(insn);
+
+		block->_insns.swap(kept);
+	    }
+	} while (changed);
+
+
+	/* Replace a test of i < n, where i is used for nothing else, with
+	   a test of whether the address reaches its final value. */
+
+	if (test == nullptr || test->_opcode != BR)
+	    continue;
+
+	bool first = !inside[index[test->_targets[0]->_label.number()]];
+	bool second = !inside[index[test->_targets[1]->_label.number()]];
+	unsigned last = index[latch->_label.number()];
+
+	for (auto &basic : ivs) {
+	    Temp i = basic.first, bound, p = 0, start = 0;
+	    const Induction &iv = basic.second;
+	    Opcode condition = test->_condition;
+	    unsigned scale = 0;
+
+	    if (iv.step != 1 || counts[i] != 2 || counts[iv.next] != 1 || first == second)
+		continue;
+
+	    if (test->_uses[0] == i)
+		bound = test->_uses[1];
+	    else if (test->_uses[1] == i) {
+		bound = test->_uses[0];
+		condition = ::swap(condition);
+	    } else
+		continue;
+
+	    if (bound >= owner.size() || inside[owner[bound]])
+		continue;
+
+	    if ((first ? condition : invert(condition)) != GE)
+		continue;
+
+	    for (auto &ptr : pointers)
+		for (auto node : body)
+		    if (get<0>(ptr.first) == i && dominates(idom, node, last))
+			for (auto insn : proc->_blocks[node]->_insns)
+			    if ((insn->_opcode == LOAD || insn->_opcode == STORE) &&
+				    insn->_uses[0] == ptr.second.first) {
+				p = ptr.second.first;
+				start = ptr.second.second;
+				scale = get<1>(ptr.first);
+			    }
+
+	    if (p == 0)
+		continue;
+
+	    Temp entered = append(proc, entry, LT, {iv.init, bound});
+	    Temp count = bound;
+
+	    if (!constant(iv.init) || defs[iv.init]->_value != 0)
+		count = append(proc, entry, SUB, {bound, iv.init});
+
+	    count = append(proc, entry, MUL, {count, entered});
+	    count = append(proc, entry, MUL, {count, append(proc, entry, CONSTANT, {}, scale)});
+	    test->_uses = {p, append(proc, entry, ADD, {start, count})};
+	    test->_condition = first ? EQ : NE;
+	    replaced ++;
+	    break;
+	}
+    }
+}
+
+
+/*
+ * Function:	eliminate (private)
+ *
+ * Description:	Perform aggressive dead code elimination on a procedure
+ *		in SSA form.
+ */
+
+static void eliminate(Procedure *proc)
+{
+    unordered_map<Instruction *, unsigned> owner;
+    vector<Instruction *> defs(proc->_temps + 1), work;
+    set<Instruction *> live;
+    vector<bool> useful, exits;
+    vector<unsigned> index, ipdom;
+    Graph succs, preds, control;
+    Instruction *divisor;
+    unsigned n, none;
+    bool changed;
+
+
+    /* Compute the postdominators, with a node added for the exit. */
+
+    number(proc, index, succs, preds);
+    n = succs.size();
+    none = n + 1;
+    succs.push_back(vector<unsigned>());
+    preds.push_back(vector<unsigned>());
+
+    for (unsigned node = 0; node < n; node ++) {
+	BasicBlock *block = proc->_blocks[node];
+
+	if (block->terminator()->_opcode == RET) {
+	    succs[node].push_back(n);
+	    preds[n].push_back(node);
+	}
+
+	for (auto insn : block->_insns) {
+	    owner[insn] = node;
+
+	    if (insn->_def != 0)
+		defs[insn->_def] = insn;
+	}
+    }
+
+    ipdom = dominators(preds, succs, n);
+
+
+    /* A block is control dependent on the branches in its postdominance
+       frontier.  A block that never reaches the exit is an infinite loop,
+       which must be kept, as must instructions with side effects,
+       including a division that might trap.  Other jumps are always
+       kept, but do not make their blocks useful. */
+
+    control = frontiers(succs, ipdom);
+    useful.resize(n + 1);
+
+    auto mark = [&](Instruction *insn) {
+	if (insn != nullptr && live.count(insn) == 0) {
+	    live.insert(insn);
+	    work.push_back(insn);
+	}
+    };
+
+    for (unsigned node = 0; node < n; node ++)
+	for (auto insn : proc->_blocks[node]->_insns) {
+	    divisor = insn->_uses.size() == 2 ? defs[insn->_uses[1]] : nullptr;
+
+	    if ((insn->isTerminator() && ipdom[node] == none) ||
+		    (!insn->isPure(divisor) && !insn->isTerminator()) ||
+		    insn->_opcode == RET)
+		mark(insn);
+	}
+
+
+    /* Mark whatever the live instructions depend upon. */
+
+    do {
+	while (!work.empty()) {
+	    Instruction *insn = work.back();
+	    unsigned node = owner[insn];
+
+	    work.pop_back();
+
+	    for (auto t : insn->_uses)
+		mark(defs[t]);
+
+	    if (!useful[node]) {
+		useful[node] = true;
+
+		for (auto branch : control[node])
+		    mark(proc->_blocks[branch]->terminator());
+	    }
+
+	    if (insn->_opcode == PHI)
+		for (auto pred : insn->_targets)
+		    mark(pred->terminator());
+	}
+
+
+	/* A branch can only be replaced by a jump to a block without live
+	   phis, since we would not know what values they should get. */
+
+	changed = false;
+
+	for (unsigned node = 0; node < n; node ++) {
+	    Instruction *insn = proc->_blocks[node]->terminator();
+
+	    if (insn->_opcode != BR || live.count(insn) > 0)
+		continue;
+
+	    unsigned target = ipdom[node];
+
+	    while (target < n && !useful[target])
+		target = ipdom[target];
+
+	    if (target < n)
+		for (auto phi : proc->_blocks[target]->_insns)
+		    if (phi->_opcode == PHI && live.count(phi) > 0) {
+			mark(insn);
+			changed = true;
+			break;
+		    }
+	}
+    } while (changed);
+
+
+    /* Delete the dead instructions and replace the dead branches. */
+
+    for (unsigned node = 0; node < n; node ++) {
+	BasicBlock *block = proc->_blocks[node];
+	vector<Instruction *> kept;
+
+	for (auto insn : block->_insns)
+	    if (live.count(insn) > 0 || insn->_opcode == JMP)
+		kept.push_back(insn);
+
+	    else if (insn->_opcode == BR) {
+		unsigned target = ipdom[node];
+
+		while (target < n && !useful[target])
+		    target = ipdom[target];
+
+		assert(target < n);
+		insn->_opcode = JMP;
+		insn->_uses.clear();
+		insn->_targets = {proc->_blocks[target]};
+		kept.push_back(insn);
+
+	    } else
+		delete insn;
+
+	block->_insns.swap(kept);
+    }
+
+    proc->link();
+}
+
+
+/*
+ * Function:	hasPhis (private)
+ *
+ * Description:	Return whether a block has any phis.
+ */
+
+static bool hasPhis(BasicBlock *block)
+{
+    for (auto insn : block->_insns)
+	if (insn->_opcode == PHI)
+	    return true;
+
+    return false;
+}
+
+
+/*
+ * Function:	isJump (private)
+ *
+ * Description:	Return whether a block does nothing but jump.
+ */
+
+static bool isJump(BasicBlock *block)
+{
+    return block->_insns.front()->_opcode == JMP;
+}
+
+
+/*
+ * Function:	simplify (private)
+ *
+ * Description:	Clean up the jumps left behind by the other passes.  A
+ *		jump to a block that does nothing but jump is sent
+ *		straight to its target, unless that block also just jumps,
+ *		and a block reached only by a jump from another block is
+ *		appended to that block.  Blocks with phis are left alone,
+ *		since their predecessors matter.
+ */
+
+static void simplify(Procedure *proc)
+{
+    bool changed;
+
+
+    do {
+	changed = false;
+
+	for (auto block : proc->_blocks) {
+	    Instruction *insn = block->terminator();
+
+	    for (auto &target : insn->_targets) {
+		BasicBlock *next = isJump(target) ? target->_insns[0]->_targets[0] : nullptr;
+
+		if (next != nullptr && !isJump(next) && !hasPhis(next)) {
+		    target = next;
+		    changed = true;
+		}
+	    }
+
+	    if (insn->_opcode == BR && insn->_targets[0] == insn->_targets[1]) {
+		insn->_opcode = JMP;
+		insn->_uses.clear();
+		insn->_targets.pop_back();
+	    }
+	}
+
+	proc->link();
+
+	for (auto block : proc->_blocks) {
+	    Instruction *insn = block->terminator();
+	    BasicBlock *next = insn->_targets.size() == 1 ? insn->_targets[0] : nullptr;
+
+	    if (insn->_opcode != JMP || next == block || next == proc->_blocks[0] ||
+		    next->_preds.size() != 1 || hasPhis(next))
+		continue;
+
+	    block->_insns.pop_back();
+	    delete insn;
+	    block->_insns.insert(block->_insns.end(), next->_insns.begin(), next->_insns.end());
+	    next->_insns.clear();
+
+	    for (auto succ : next->_succs)
+		for (auto phi : succ->_insns)
+		    if (phi->_opcode == PHI)
+			replace(phi->_targets.begin(), phi->_targets.end(), next, block);
+
+	    proc->link();
+	    changed = true;
+	    break;
+	}
+    } while (changed);
+}
+
+
+/*
+ * Function:	Procedure::optimize
+ *
+ * Description:	Optimize this procedure at the given level.
+ */
+
+void Procedure::optimize(unsigned level)
+{
+    if (level >= 1) {
+	construct(this);
+	propagate(this);
+	reuse(this);
+	hoist(this);
+	eliminate(this);
+	reduce(this);
+	eliminate(this);
+	simplify(this);
+    }
+}
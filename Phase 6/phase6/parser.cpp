@@ -6,10 +6,13 @@
  *		Simple C.
  */
 
+# include <chrono>
 # include <cstdlib>
 # include <iostream>
+# include <sys/resource.h>
 # include "generator.h"
 # include "checker.h"
+# include "IR.h"
 # include "string.h"
 # include "tokens.h"
 # include "lexer.h"
@@ -17,11 +20,16 @@
 using namespace std;
 
 static int lookahead;
-static string lexbuf;
+static Lexeme lexeme;
 
 static Expression *expression();
 static Statement *statement();
 static Type returnType;
+static Arena arena;
+static vector<Function *> pending;
+static unsigned jobs = 1;
+
+static const unsigned FUNCTIONS_PER_JOB = 16;
 
 
 /*
@@ -35,7 +43,7 @@ static void error()
     if (lookahead == DONE)
 	report("syntax error at end of file");
     else
-	report("syntax error at '%s'", lexbuf);
+	report("syntax error at '%s'", lexeme.str());
 
     exit(EXIT_FAILURE);
 }
@@ -54,7 +62,7 @@ static void match(int t)
     if (lookahead != t)
 	error();
 
-    lookahead = lexan(lexbuf);
+    lookahead = lexan(lexeme);
 }
 
 
@@ -69,7 +77,7 @@ static unsigned number()
     string buf;
 
 
-    buf = lexbuf;
+    buf = lexeme.str();
     match(NUM);
     return strtoul(buf.c_str(), NULL, 0);
 }
@@ -78,17 +86,18 @@ static unsigned number()
 /*
  * Function:	identifier
  *
- * Description:	Match the next token as an identifier and return its name.
+ * Description:	Match the next token as an identifier and return its name,
+ *		which the lexer has already interned for us.
  */
 
-static string identifier()
+static Atom identifier()
 {
-    string buf;
+    Atom name;
 
 
-    buf = lexbuf;
+    name = lexeme.atom;
     match(ID);
-    return buf;
+    return name;
 }
 
 
@@ -160,16 +169,18 @@ static unsigned pointers()
  *
  * Description:	Parse a declarator, which in Simple C is either a scalar
  *		variable or an array, with optional pointer declarators.
+ *		The variable is marked if it was declared with register.
  *
  *		declarator:
  *		  pointers identifier
  *		  pointers identifier [ num ]
  */
 
-static void declarator(int typespec)
+static void declarator(int typespec, bool hint)
 {
     unsigned indirection;
-    string name;
+    Symbol *symbol;
+    Atom name;
 
 
     indirection = pointers();
@@ -177,10 +188,12 @@ static void declarator(int typespec)
 
     if (lookahead == '[') {
 	match('[');
-	declareVariable(name, Type(typespec, indirection, number()));
+	symbol = declareVariable(name, Type(typespec, indirection, number()));
 	match(']');
     } else
-	declareVariable(name, Type(typespec, indirection));
+	symbol = declareVariable(name, Type(typespec, indirection));
+
+    symbol->_hint = hint;
 }
 
 
@@ -193,6 +206,7 @@ static void declarator(int typespec)
  *
  *		declaration:
  *		  specifier declarator-list ';'
+ *		  register specifier declarator-list ';'
  *
  *		declarator-list:
  *		  declarator
@@ -202,14 +216,20 @@ static void declarator(int typespec)
 static void declaration()
 {
     int typespec;
+    bool hint = false;
 
 
+    if (lookahead == REGISTER) {
+	match(REGISTER);
+	hint = true;
+    }
+
     typespec = specifier();
-    declarator(typespec);
+    declarator(typespec, hint);
 
     while (lookahead == ',') {
 	match(',');
-	declarator(typespec);
+	declarator(typespec, hint);
     }
 
     match(';');
@@ -228,7 +248,7 @@ static void declaration()
 
 static void declarations()
 {
-    while (isSpecifier(lookahead))
+    while (isSpecifier(lookahead) || lookahead == REGISTER)
 	declaration();
 }
 
@@ -263,12 +283,11 @@ static Expression *primaryExpression()
 	match(')');
 
     } else if (lookahead == STRING) {
-	lexbuf = lexbuf.substr(1, lexbuf.size() - 2);
-	expr = new String(escapeString(parseString(lexbuf)));
+	expr = new String(escapeString(parseString(string(lexeme.text + 1, lexeme.length - 2))));
 	match(STRING);
 
     } else if (lookahead == NUM) {
-	expr = new Number(lexbuf);
+	expr = new Number(lexeme.str());
 	match(NUM);
 
     } else if (lookahead == ID) {
@@ -708,7 +727,7 @@ static Statement *statement()
 	checkTest(expr);
 	match(')');
 	stmt = statement();
-	return new While(expr, stmt);
+	return checkWhile(expr, stmt);
     }
 
     if (lookahead == FOR) {
@@ -722,7 +741,7 @@ static Statement *statement()
 	incr = assignment();
 	match(')');
 	stmt = statement();
-	return new For(init, expr, incr, stmt);
+	return checkFor(init, expr, incr, stmt);
     }
 
     if (lookahead == IF) {
@@ -734,10 +753,10 @@ static Statement *statement()
 	stmt = statement();
 
 	if (lookahead != ELSE)
-	    return new If(expr, stmt, nullptr);
+	    return checkIf(expr, stmt, nullptr);
 
 	match(ELSE);
-	return new If(expr, stmt, statement());
+	return checkIf(expr, stmt, statement());
     }
 
     stmt = assignment();
@@ -760,7 +779,7 @@ static Type parameter()
 {
     int typespec;
     unsigned indirection;
-    string name;
+    Atom name;
     Type type;
 
 
@@ -796,7 +815,7 @@ static Parameters *parameters()
     int typespec;
     unsigned indirection;
     Parameters *params;
-    string name;
+    Atom name;
     Type type;
 
 
@@ -844,7 +863,7 @@ static Parameters *parameters()
 static void globalDeclarator(int typespec)
 {
     unsigned indirection;
-    string name;
+    Atom name;
 
 
     indirection = pointers();
@@ -886,6 +905,24 @@ static void remainingDeclarators(int typespec)
 }
 
 
+/*
+ * Function:	generatePending
+ *
+ * Description:	Generate code for any pending functions.  Then their trees
+ *		and scopes, and the input we've read so far, are released
+ *		before we go on.
+ */
+
+static void generatePending()
+{
+    generateFunctions(pending, jobs);
+    pending.clear();
+
+    arena.reset();
+    releaseInput();
+}
+
+
 /*
  * Function:	globalOrFunction
  *
@@ -896,13 +933,17 @@ static void remainingDeclarators(int typespec)
  * 		  specifier pointers identifier ( ) remaining-decls 
  * 		  specifier pointers identifier [ num ] remaining-decls
  * 		  specifier pointers identifier ( parameters ) { ... }
+ *
+ *		A function definition is checked as soon as it has been
+ *		parsed, and generated once enough functions are pending to
+ *		keep every thread busy.
  */
 
 static void globalOrFunction()
 {
     int typespec;
     unsigned indirection;
-    string name;
+    Atom name;
     Statements stmts;
     Function *function;
     Symbol *symbol;
@@ -928,6 +969,7 @@ static void globalOrFunction()
 	    remainingDeclarators(typespec);
 
 	} else {
+	    Arena::current = &arena;
 	    openScope();
 	    returnType = Type(typespec, indirection);
 	    symbol = defineFunction(name, Type(typespec, indirection, parameters()));
@@ -939,9 +981,14 @@ static void globalOrFunction()
 	    function = new Function(symbol, new Block(decls, stmts));
 	    match('}');
 
+	    Arena::current = nullptr;
+
 	    if (numerrors == 0)
-		function->generate();
-		//function->write(cout);
+		pending.push_back(function);
+
+	    if (pending.empty() || jobs == 1 ||
+		    pending.size() == jobs * FUNCTIONS_PER_JOB)
+		generatePending();
 	}
 
     } else {
@@ -951,20 +998,125 @@ static void globalOrFunction()
 }
 
 
+/*
+ * Function:	usage
+ *
+ * Description:	Report how to invoke the compiler and exit.
+ */
+
+static void usage(const char *prog)
+{
+    cerr << "usage: " << prog << " [-o file] [-j jobs] [-Olevel] [-Os] [--ir] [--emit-ir] [--stats] [file]" << endl;
+    exit(EXIT_FAILURE);
+}
+
+
 /*
  * Function:	main
  *
- * Description:	Analyze the standard input stream.
+ * Description:	Analyze the given source file, or the standard input
+ *		stream if none is given.  The generated code is written to
+ *		the standard output unless a file is given with -o, and
+ *		if it cannot all be written, we fail.  With -j, code is
+ *		generated by that many threads, with the same result.
+ *		With --ir, code is generated by way of the intermediate
+ *		representation, and with --emit-ir, the intermediate
+ *		representation is written instead.  With -O1 or higher,
+ *		the intermediate representation is also optimized.  With
+ *		-Os, loops are laid out to be smaller rather than faster.
+ *		With --stats, the amount of code emitted, the rate at
+ *		which it was emitted, the number of registers spilled and
+ *		reloaded by the generator, the number of recomputations
+ *		and reads of memory eliminated, of instructions moved out
+ *		of loops, and of induction variables added and loop tests
+ *		replaced by the optimizer,
+ *		the most memory used by the trees of any one batch of
+ *		functions, and the peak resident memory of the process
+ *		are reported to the standard error.
  */
 
-int main()
+int main(int argc, char *argv[])
 {
+    bool stats = false;
+    string input;
+    chrono::steady_clock::time_point start;
+    struct rusage resources;
+    double elapsed;
+
+
+    for (int i = 1; i < argc; i ++) {
+	string arg = argv[i];
+
+	if (arg == "-o" && i + 1 < argc) {
+	    if (!output.open(argv[++ i])) {
+		cerr << argv[0] << ": cannot open " << argv[i] << endl;
+		exit(EXIT_FAILURE);
+	    }
+
+	} else if (arg == "--stats")
+	    stats = true;
+
+	else if (arg == "--ir")
+	    useIR = true;
+
+	else if (arg == "-Os")
+	    optimizeSize = true;
+
+	else if (arg.compare(0, 2, "-O") == 0)
+	    optimization = arg.size() > 2 ? atoi(arg.c_str() + 2) : 1;
+
+	else if (arg == "--emit-ir")
+	    emitIR = true;
+
+	else if (arg == "-j" && i + 1 < argc) {
+	    jobs = atoi(argv[++ i]);
+
+	    if (jobs == 0)
+		usage(argv[0]);
+
+	} else if (arg[0] != '-' && input.empty())
+	    input = arg;
+
+	else
+	    usage(argv[0]);
+    }
+
+    if (!openInput(input)) {
+	cerr << argv[0] << ": cannot read " << input << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    start = chrono::steady_clock::now();
     openScope();
-    lookahead = lexan(lexbuf);
+    lookahead = lexan(lexeme);
 
     while (lookahead != DONE)
 	globalOrFunction();
 
+    generatePending();
     generateGlobals(closeScope());
+
+    if (!output.flush()) {
+	cerr << argv[0] << ": write error" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (stats) {
+	elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cerr << "bytes emitted: " << output.written() << endl;
+	cerr << "elapsed time: " << elapsed << " s" << endl;
+	cerr << "throughput: " << (unsigned long) (output.written() / elapsed) << " bytes/s" << endl;
+	cerr << "spills: " << spills << endl;
+	cerr << "reloads: " << reloads << endl;
+	cerr << "recomputations eliminated: " << recomputations << endl;
+	cerr << "loads forwarded: " << forwarded << endl;
+	cerr << "instructions hoisted: " << hoisted << endl;
+	cerr << "induction variables added: " << reduced << endl;
+	cerr << "loop tests replaced: " << replaced << endl;
+	cerr << "peak arena: " << arena.peak() << " bytes" << endl;
+	getrusage(RUSAGE_SELF, &resources);
+	cerr << "peak RSS: " << resources.ru_maxrss << " KB" << endl;
+    }
+
     exit(EXIT_SUCCESS);
 }
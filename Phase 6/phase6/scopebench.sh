@@ -0,0 +1,40 @@
+#!/bin/sh
+#
+# File:		scopebench.sh
+#
+# Description:	Measure how long the compiler takes on files with many
+#		names in the global scope.  Two files are written: one
+#		declaring a given number of global variables, by default
+#		one hundred thousand, and one defining a fifth as many
+#		one-line functions.  Each is compiled with --stats, and
+#		the time taken is reported.  The compiler is ./scc unless
+#		another is given by SCC, so two builds can be compared.
+#
+# Usage:	sh scopebench.sh [globals]
+#
+
+GLOBALS=${1:-100000}
+SCC=${SCC:-./scc}
+TMP=${TMPDIR:-/tmp}/scopebench.$$
+
+trap 'rm -rf $TMP' 0 1 2 15
+mkdir $TMP || exit 1
+
+awk -v n=$GLOBALS 'BEGIN {
+    for (i = 0; i < n; i ++)
+	printf "int g%d;\n", i
+
+    printf "int main(void) { g%d = 1; return g0; }\n", n - 1
+}' > $TMP/globals.c || exit 1
+
+awk -v n=$(($GLOBALS / 5)) 'BEGIN {
+    for (i = 0; i < n; i ++)
+	printf "int f%d(int a) { return a + %d; }\n", i, i
+
+    printf "int main(void) { return f%d(1); }\n", n - 1
+}' > $TMP/functions.c || exit 1
+
+for FILE in globals functions; do
+    printf "%s: " $FILE
+    "$SCC" --stats -o /dev/null $TMP/$FILE.c 2>&1 | grep "elapsed time"
+done
@@ -0,0 +1,977 @@
+/*
+ * File:	selector.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		selecting x86 instructions from the intermediate
+ *		representation of a procedure.
+ *
+ *		Selection happens in three steps.  First, phi instructions
+ *		are replaced by copies.  A phi becomes a copy from a new
+ *		temporary at the start of its block, and each predecessor
+ *		copies its operand into that temporary just before
+ *		jumping, so that every value is read before any is
+ *		written.  Most of these copies are then removed again by
+ *		coalescing.
+ *
+ *		Second, temporaries are given locations by linear scan
+ *		register allocation.  Each temporary is live from its
+ *		first definition to its last use, including any blocks in
+ *		between where it is live, and is kept in %ecx, %ebx, %esi,
+ *		or %edi if one is free for that whole interval, and in a
+ *		stack slot otherwise.  Temporaries used inside loops are
+ *		the last to be spilled.  Since %ecx is not preserved by a
+ *		call, it is only used for temporaries not live across one,
+ *		and the others are saved and restored by the function if
+ *		they are used at all.  Constants are never given a
+ *		location since they can be used as immediate operands.
+ *
+ *		Finally, each instruction is written using %eax and %edx
+ *		for any intermediate results.
+ */
+
+# include <cassert>
+# include <set>
+# include <algorithm>
+# include "IR.h"
+# include "Tree.h"
+# include "Register.h"
+# include "machine.h"
+
+using namespace std;
+
+static Register eax("%eax", "%al");
+static Register ecx("%ecx", "%cl");
+static Register edx("%edx", "%dl");
+static Register ebx("%ebx", "%bl");
+static Register esi("%esi");
+static Register edi("%edi");
+
+static Register *const allocatable[] = {&ecx, &ebx, &esi, &edi};
+
+struct Location {
+    Register *reg;
+    int offset;
+    bool immediate;
+    int value;
+};
+
+struct Interval {
+    Temp temp;
+    unsigned start, end, weight;
+    bool crossesCall;
+};
+
+static const char *suffixes[] = {"e", "ne", "l", "g", "le", "ge"};
+
+static thread_local vector<Location> locations;
+static thread_local vector<unsigned> counts;
+static thread_local int scratch;
+
+
+/*
+ * Function:	operator << (private)
+ *
+ * Description:	Write the location of a temporary as an operand.
+ */
+
+static ostream &operator <<(ostream &ostr, const Location &loc)
+{
+    if (loc.reg != nullptr)
+	return ostr << loc.reg;
+
+    if (loc.immediate)
+	return ostr << "$" << loc.value;
+
+    return ostr << loc.offset << "(%ebp)";
+}
+
+
+/*
+ * Function:	isMemory (private)
+ *
+ * Description:	Return whether a location is a stack slot.
+ */
+
+static bool isMemory(const Location &loc)
+{
+    return loc.reg == nullptr && !loc.immediate;
+}
+
+
+/*
+ * Function:	variable (private)
+ *
+ * Description:	Write a variable as an operand, much as an identifier is
+ *		written by the generator.
+ */
+
+static void variable(ostream &ostr, const Symbol *symbol)
+{
+    if (symbol->_offset == 0)
+	ostr << global_prefix << symbol->name();
+    else
+	ostr << symbol->_offset << "(%ebp)";
+}
+
+
+/*
+ * Function:	move (private)
+ *
+ * Description:	Copy a value from one location to another, going through
+ *		%eax if both are in memory.
+ */
+
+static void move(ostream &ostr, const Location &src, const Location &dst)
+{
+    if (src.reg != nullptr && src.reg == dst.reg)
+	return;
+
+    if (!src.immediate && src.reg == nullptr && dst.reg == nullptr) {
+	ostr << "\tmovl\t" << src << ", %eax\n";
+	ostr << "\tmovl\t%eax, " << dst << "\n";
+    } else
+	ostr << "\tmovl\t" << src << ", " << dst << "\n";
+}
+
+
+/*
+ * Function:	result (private)
+ *
+ * Description:	Return the register in which to compute the value of a
+ *		temporary: its own register if it has one, and %eax
+ *		otherwise.
+ */
+
+static Register *result(Temp t)
+{
+    return locations[t].reg != nullptr ? locations[t].reg : &eax;
+}
+
+
+/*
+ * Function:	finish (private)
+ *
+ * Description:	Move a value computed in the given register to the
+ *		location of its temporary, if it is not already there.
+ */
+
+static void finish(ostream &ostr, Register *reg, Temp t)
+{
+    if (locations[t].reg != reg)
+	ostr << "\tmovl\t" << reg << ", " << locations[t] << "\n";
+}
+
+
+/*
+ * Function:	compare (private)
+ *
+ * Description:	Compare two temporaries and return the condition that
+ *		must be tested, which is swapped if the operands are.  The
+ *		second operand of cmpl cannot be an immediate, and both
+ *		operands cannot be in memory.
+ */
+
+static Opcode compare(ostream &ostr, Opcode condition, Temp left, Temp right)
+{
+    const Location &a = locations[left], &b = locations[right];
+
+
+    if (a.immediate && !b.immediate) {
+	ostr << "\tcmpl\t" << a << ", " << b << "\n";
+	return swap(condition);
+    }
+
+    if (a.immediate || (isMemory(a) && isMemory(b))) {
+	ostr << "\tmovl\t" << a << ", %eax\n";
+	ostr << "\tcmpl\t" << b << ", %eax\n";
+    } else
+	ostr << "\tcmpl\t" << b << ", " << a << "\n";
+
+    return condition;
+}
+
+
+/*
+ * Function:	address (private)
+ *
+ * Description:	Return a register holding the address in a temporary,
+ *		loading it into the given register if necessary.
+ */
+
+static Register *address(ostream &ostr, Temp t, Register *reg)
+{
+    if (locations[t].reg != nullptr)
+	return locations[t].reg;
+
+    ostr << "\tmovl\t" << locations[t] << ", " << reg << "\n";
+    return reg;
+}
+
+
+/*
+ * Function:	eliminatePhis (private)
+ *
+ * Description:	Replace each phi instruction by copies, as described above.
+ */
+
+static void eliminatePhis(Procedure *proc)
+{
+    Instruction *copy;
+    BasicBlock *pred;
+    Temp t;
+
+
+    for (auto block : proc->_blocks)
+	for (auto insn : block->_insns)
+	    if (insn->_opcode == PHI) {
+		t = proc->temp();
+
+		for (unsigned i = 0; i < insn->_uses.size(); i ++) {
+		    pred = insn->_targets[i];
+		    copy = new Instruction(COPY, t);
+		    copy->_uses = {insn->_uses[i]};
+		    pred->_insns.insert(pred->_insns.end() - 1, copy);
+		}
+
+		insn->_opcode = COPY;
+		insn->_uses = {t};
+		insn->_targets.clear();
+	    }
+}
+
+
+/*
+ * Function:	liveness (private)
+ *
+ * Description:	Compute the temporaries live into and out of each block,
+ *		going backwards until nothing changes.  The index of each
+ *		block, given its label number, is also returned.
+ */
+
+static void liveness(Procedure *proc, vector<unsigned> &index,
+		     vector<vector<bool>> &in, vector<vector<bool>> &out)
+{
+    unsigned n = proc->_blocks.size();
+    vector<vector<bool>> gen(n), kill(n);
+    bool changed;
+
+
+    /* Number each block and find what it uses before defining. */
+
+    for (auto block : proc->_blocks)
+	index.resize(max<size_t>(index.size(), block->_label.number() + 1));
+
+    in.assign(n, vector<bool>(proc->_temps + 1));
+    out.assign(n, vector<bool>(proc->_temps + 1));
+
+    for (unsigned i = 0; i < n; i ++) {
+	BasicBlock *block = proc->_blocks[i];
+	index[block->_label.number()] = i;
+	gen[i].resize(proc->_temps + 1);
+	kill[i].resize(proc->_temps + 1);
+
+	for (auto insn : block->_insns) {
+	    for (auto t : insn->_uses)
+		if (!kill[i][t])
+		    gen[i][t] = true;
+
+	    if (insn->_def != 0)
+		kill[i][insn->_def] = true;
+	}
+    }
+
+
+    /* Compute the live sets. */
+
+    do {
+	changed = false;
+
+	for (int i = n - 1; i >= 0; i --) {
+	    BasicBlock *block = proc->_blocks[i];
+	    vector<bool> live(proc->_temps + 1);
+
+	    for (auto succ : block->_succs)
+		for (unsigned t = 1; t <= proc->_temps; t ++)
+		    if (in[index[succ->_label.number()]][t])
+			live[t] = true;
+
+	    out[i] = live;
+
+	    for (unsigned t = 1; t <= proc->_temps; t ++)
+		live[t] = gen[i][t] || (live[t] && !kill[i][t]);
+
+	    if (live != in[i]) {
+		in[i] = live;
+		changed = true;
+	    }
+	}
+    } while (changed);
+}
+
+
+/*
+ * Function:	coalesce (private)
+ *
+ * Description:	Remove as many copies as possible by renaming the source
+ *		and destination of each to the same temporary, so that
+ *		they are given the same location.  This is possible
+ *		whenever no temporary renamed to one is live where a
+ *		temporary renamed to the other is defined.  Since most
+ *		copies come from eliminating phis, this is what keeps a
+ *		variable of a loop in the same register all the way
+ *		around it.  The copies in the most deeply nested blocks
+ *		are tried first.
+ */
+
+static void coalesce(Procedure *proc)
+{
+    vector<vector<bool>> in, out;
+    vector<unsigned> index;
+    vector<Temp> parent(proc->_temps + 1), live;
+    vector<vector<Temp>> members(proc->_temps + 1);
+    vector<bool> candidate(proc->_temps + 1), isLive(proc->_temps + 1);
+    vector<pair<unsigned, Instruction *>> copies;
+    set<pair<Temp, Temp>> interferes;
+
+
+    /* Find the copies between temporaries that might be coalesced. */
+
+    for (auto block : proc->_blocks)
+	for (auto insn : block->_insns)
+	    if (insn->_opcode == COPY && !locations[insn->_uses[0]].immediate) {
+		candidate[insn->_def] = candidate[insn->_uses[0]] = true;
+		copies.push_back(make_pair(block->_depth, insn));
+	    }
+
+    if (copies.empty())
+	return;
+
+
+    /* Find which of those temporaries interfere, walking backwards
+       through each block and noting what is live at each definition. */
+
+    liveness(proc, index, in, out);
+
+    for (unsigned i = 0; i < proc->_blocks.size(); i ++) {
+	BasicBlock *block = proc->_blocks[i];
+	live.clear();
+
+	for (Temp t = 1; t <= proc->_temps; t ++)
+	    if ((isLive[t] = out[i][t] && candidate[t]))
+		live.push_back(t);
+
+	for (int j = block->_insns.size() - 1; j >= 0; j --) {
+	    Instruction *insn = block->_insns[j];
+	    Temp def = insn->_def;
+
+	    if (def != 0 && candidate[def]) {
+		for (auto t : live)
+		    if (t != def && (insn->_opcode != COPY || t != insn->_uses[0]))
+			interferes.insert(make_pair(min(t, def), max(t, def)));
+
+		if (isLive[def]) {
+		    isLive[def] = false;
+		    live.erase(find(live.begin(), live.end(), def));
+		}
+	    }
+
+	    for (auto t : insn->_uses)
+		if (candidate[t] && !isLive[t]) {
+		    isLive[t] = true;
+		    live.push_back(t);
+		}
+	}
+
+	for (auto t : live)
+	    isLive[t] = false;
+    }
+
+
+    /* Merge the temporaries of each copy unless they interfere. */
+
+    for (Temp t = 0; t <= proc->_temps; t ++) {
+	parent[t] = t;
+	members[t].push_back(t);
+    }
+
+    stable_sort(copies.begin(), copies.end(),
+		[](const pair<unsigned, Instruction *> &a,
+		   const pair<unsigned, Instruction *> &b) {
+		    return a.first > b.first;
+		});
+
+    for (auto &copy : copies) {
+	Temp a = parent[copy.second->_def], b = parent[copy.second->_uses[0]];
+	bool conflict = false;
+
+	if (a == b)
+	    continue;
+
+	for (auto s : members[a])
+	    for (auto t : members[b])
+		if (interferes.count(make_pair(min(s, t), max(s, t))))
+		    conflict = true;
+
+	if (!conflict) {
+	    for (auto t : members[b]) {
+		parent[t] = a;
+		members[a].push_back(t);
+	    }
+
+	    members[b].clear();
+	}
+    }
+
+
+    /* Rename the temporaries and delete the copies that are now useless. */
+
+    for (auto block : proc->_blocks) {
+	unsigned j = 0;
+
+	for (auto insn : block->_insns) {
+	    insn->_def = parent[insn->_def];
+
+	    for (auto &t : insn->_uses)
+		t = parent[t];
+
+	    if (insn->_opcode == COPY && insn->_def == insn->_uses[0])
+		delete insn;
+	    else
+		block->_insns[j ++] = insn;
+	}
+
+	block->_insns.resize(j);
+    }
+}
+
+
+/*
+ * Function:	computeIntervals (private)
+ *
+ * Description:	Number the instructions in order, and then compute the
+ *		interval of each temporary that is used.  Each use or
+ *		definition adds to the weight of an interval, ten times
+ *		more for each loop it is in, which is how much it would
+ *		cost to spill it.  The positions of the calls are also
+ *		returned.
+ */
+
+static void computeIntervals(Procedure *proc, vector<Interval> &intervals,
+			     vector<unsigned> &calls)
+{
+    unsigned n = proc->_blocks.size(), pos, cost, j;
+    vector<vector<bool>> in, out;
+    vector<unsigned> first(n), last(n), index, weight(proc->_temps + 1);
+    vector<unsigned> start(proc->_temps + 1, ~0u), end(proc->_temps + 1, 0);
+
+
+    liveness(proc, index, in, out);
+    pos = 0;
+
+    for (unsigned i = 0; i < n; i ++) {
+	first[i] = pos;
+
+	for (auto insn : proc->_blocks[i]->_insns) {
+	    if (insn->_opcode == CALL)
+		calls.push_back(pos);
+
+	    pos += 2;
+	}
+
+	last[i] = pos - 2;
+    }
+
+
+    /* Each interval is the hull of every position where it is live. */
+
+    pos = 0;
+
+    for (unsigned i = 0; i < n; i ++) {
+	for (unsigned t = 1; t <= proc->_temps; t ++) {
+	    if (in[i][t])
+		start[t] = min(start[t], first[i]);
+
+	    if (out[i][t])
+		end[t] = max(end[t], last[i]);
+	}
+
+	for (cost = 1, j = 0; j < proc->_blocks[i]->_depth && j < 4; j ++)
+	    cost *= 10;
+
+	for (auto insn : proc->_blocks[i]->_insns) {
+	    for (auto t : insn->_uses) {
+		end[t] = max(end[t], pos);
+		weight[t] += cost;
+	    }
+
+	    if (insn->_def != 0) {
+		start[insn->_def] = min(start[insn->_def], pos);
+		end[insn->_def] = max(end[insn->_def], pos);
+		weight[insn->_def] += cost;
+	    }
+
+	    pos += 2;
+	}
+    }
+
+    for (Temp t = 1; t <= proc->_temps; t ++)
+	if (counts[t] > 0 && !locations[t].immediate) {
+	    Interval interval = {t, start[t], end[t], weight[t], false};
+	    auto call = upper_bound(calls.begin(), calls.end(), start[t]);
+
+	    interval.crossesCall = call != calls.end() && *call < end[t];
+	    intervals.push_back(interval);
+	}
+
+    sort(intervals.begin(), intervals.end(),
+	 [](const Interval &a, const Interval &b) { return a.start < b.start; });
+}
+
+
+/*
+ * Function:	spill (private)
+ *
+ * Description:	Give a temporary a new stack slot, unless it already has
+ *		one of its own.
+ */
+
+static void spill(Temp t, int &offset)
+{
+    if (locations[t].offset == 0) {
+	offset -= SIZEOF_REG;
+	locations[t].offset = offset;
+    }
+}
+
+
+/*
+ * Function:	findHomes (private)
+ *
+ * Description:	A temporary defined only by reading a parameter that is
+ *		never written can simply stay where the caller put it if
+ *		it is spilled, so give it the slot of the parameter.
+ */
+
+static void findHomes(Procedure *proc)
+{
+    vector<const Symbol *> written;
+    vector<Instruction *> defs(proc->_temps + 1);
+    vector<unsigned> numDefs(proc->_temps + 1);
+
+
+    for (auto block : proc->_blocks)
+	for (auto insn : block->_insns) {
+	    if (insn->_opcode == PUT || insn->_opcode == ADDRESS)
+		written.push_back(insn->_symbol);
+
+	    if (insn->_def != 0) {
+		defs[insn->_def] = insn;
+		numDefs[insn->_def] ++;
+	    }
+	}
+
+    for (Temp t = 1; t <= proc->_temps; t ++)
+	if (numDefs[t] == 1 && defs[t]->_opcode == GET) {
+	    const Symbol *symbol = defs[t]->_symbol;
+
+	    if (symbol->_offset > 0 && defs[t]->_size == SIZEOF_REG &&
+		    find(written.begin(), written.end(), symbol) == written.end())
+		locations[t].offset = symbol->_offset;
+	}
+}
+
+
+/*
+ * Function:	allocate (private)
+ *
+ * Description:	Assign registers to the intervals by linear scan.  When
+ *		no register is free, whichever of the intervals weighs
+ *		least is spilled to a new stack slot, preferring the one
+ *		that ends last if they weigh the same.  The callee-saved
+ *		registers that were used are returned.
+ */
+
+static vector<Register *> allocate(vector<Interval> &intervals, int &offset)
+{
+    vector<Interval *> active;
+    vector<Register *> saved;
+    Register *reg;
+
+
+    for (auto &current : intervals) {
+	for (unsigned i = 0; i < active.size(); )
+	    if (active[i]->end <= current.start)
+		active.erase(active.begin() + i);
+	    else
+		i ++;
+
+	reg = nullptr;
+
+	for (auto candidate : allocatable) {
+	    if (candidate == &ecx && current.crossesCall)
+		continue;
+
+	    bool free = true;
+
+	    for (auto other : active)
+		if (locations[other->temp].reg == candidate)
+		    free = false;
+
+	    if (free) {
+		reg = candidate;
+		break;
+	    }
+	}
+
+	if (reg == nullptr) {
+	    Interval *victim = &current;
+
+	    for (auto other : active)
+		if (!current.crossesCall || locations[other->temp].reg != &ecx)
+		    if (other->weight < victim->weight || (other->weight
+			    == victim->weight && other->end > victim->end))
+			victim = other;
+
+	    if (victim != &current) {
+		reg = locations[victim->temp].reg;
+		locations[victim->temp].reg = nullptr;
+		spill(victim->temp, offset);
+		active.erase(find(active.begin(), active.end(), victim));
+	    }
+	}
+
+	if (reg != nullptr) {
+	    locations[current.temp].reg = reg;
+	    active.push_back(&current);
+
+	    if (reg != &ecx && find(saved.begin(), saved.end(), reg) == saved.end())
+		saved.push_back(reg);
+	} else
+	    spill(current.temp, offset);
+    }
+
+    return saved;
+}
+
+
+/*
+ * Function:	select (private)
+ *
+ * Description:	Write the x86 instructions for a single IR instruction.
+ *		The block that will follow this one is used to avoid
+ *		jumping to the next instruction.
+ */
+
+static void select(ostream &ostr, Instruction *insn, BasicBlock *next,
+		   const Symbol *id, int &offset)
+{
+    const vector<Temp> &uses = insn->_uses;
+    Temp def = insn->_def, left, right;
+    Register *reg;
+    Opcode condition;
+    unsigned numBytes;
+
+
+    switch (insn->_opcode) {
+    case CONSTANT:
+	break;
+
+    case ADDRESS:
+	if (insn->_string != nullptr) {
+	    ostr << "\tmovl\t$";
+	    insn->_string->operand(ostr);
+	    ostr << ", " << locations[def] << "\n";
+
+	} else if (insn->_symbol->_offset == 0) {
+	    ostr << "\tmovl\t$";
+	    variable(ostr, insn->_symbol);
+	    ostr << ", " << locations[def] << "\n";
+
+	} else {
+	    reg = result(def);
+	    ostr << "\tleal\t";
+	    variable(ostr, insn->_symbol);
+	    ostr << ", " << reg << "\n";
+	    finish(ostr, reg, def);
+	}
+
+	break;
+
+    case GET:
+	if (isMemory(locations[def]) && locations[def].offset == insn->_symbol->_offset)
+	    break;
+
+	reg = result(def);
+	ostr << (insn->_size == SIZEOF_CHAR ? "\tmovsbl\t" : "\tmovl\t");
+	variable(ostr, insn->_symbol);
+	ostr << ", " << reg << "\n";
+	finish(ostr, reg, def);
+	break;
+
+    case PUT:
+	reg = locations[uses[0]].reg;
+
+	if (insn->_size == SIZEOF_CHAR) {
+	    if (locations[uses[0]].immediate)
+		ostr << "\tmovb\t" << locations[uses[0]] << ", ";
+	    else {
+		if (reg == nullptr || reg->byte().empty()) {
+		    ostr << "\tmovl\t" << locations[uses[0]] << ", %eax\n";
+		    reg = &eax;
+		}
+
+		ostr << "\tmovb\t" << reg->byte() << ", ";
+	    }
+
+	} else {
+	    if (isMemory(locations[uses[0]])) {
+		ostr << "\tmovl\t" << locations[uses[0]] << ", %eax\n";
+		ostr << "\tmovl\t%eax, ";
+	    } else
+		ostr << "\tmovl\t" << locations[uses[0]] << ", ";
+	}
+
+	variable(ostr, insn->_symbol);
+	ostr << "\n";
+	break;
+
+    case LOAD:
+	reg = address(ostr, uses[0], &eax);
+	ostr << (insn->_size == SIZEOF_CHAR ? "\tmovsbl\t(" : "\tmovl\t(");
+	ostr << reg << "), " << result(def) << "\n";
+	finish(ostr, result(def), def);
+	break;
+
+    case STORE:
+	reg = address(ostr, uses[0], &eax);
+
+	if (locations[uses[1]].immediate) {
+	    ostr << (insn->_size == SIZEOF_CHAR ? "\tmovb\t" : "\tmovl\t");
+	    ostr << locations[uses[1]];
+
+	} else {
+	    Register *value = locations[uses[1]].reg;
+
+	    if (value == nullptr || (insn->_size == SIZEOF_CHAR && value->byte().empty())) {
+		ostr << "\tmovl\t" << locations[uses[1]] << ", %edx\n";
+		value = &edx;
+	    }
+
+	    if (insn->_size == SIZEOF_CHAR)
+		ostr << "\tmovb\t" << value->byte();
+	    else
+		ostr << "\tmovl\t" << value;
+	}
+
+	ostr << ", (" << reg << ")\n";
+	break;
+
+    case COPY:
+	move(ostr, locations[uses[0]], locations[def]);
+	break;
+
+    case ADD:
+    case SUB:
+    case MUL:
+	reg = result(def);
+	left = uses[0];
+	right = uses[1];
+
+	if (reg == locations[right].reg && left != right) {
+	    if (insn->_opcode != SUB)
+		std::swap(left, right);
+	    else
+		reg = &eax;
+	}
+
+	if (locations[left].reg != reg)
+	    ostr << "\tmovl\t" << locations[left] << ", " << reg << "\n";
+
+	ostr << (insn->_opcode == ADD ? "\taddl\t" : insn->_opcode == SUB ? "\tsubl\t" : "\timull\t");
+	ostr << locations[right] << ", " << reg << "\n";
+	finish(ostr, reg, def);
+	break;
+
+    case DIVIDE:
+    case REMAINDER:
+	ostr << "\tmovl\t" << locations[uses[0]] << ", %eax\n";
+	ostr << "\tcltd\n";
+
+	if (locations[uses[1]].immediate) {
+	    if (scratch == 0)
+		scratch = offset -= SIZEOF_REG;
+
+	    ostr << "\tmovl\t" << locations[uses[1]] << ", " << scratch << "(%ebp)\n";
+	    ostr << "\tidivl\t" << scratch << "(%ebp)\n";
+	} else
+	    ostr << "\tidivl\t" << locations[uses[1]] << "\n";
+
+	if (counts[def] > 0)
+	    finish(ostr, insn->_opcode == DIVIDE ? &eax : &edx, def);
+	break;
+
+    case NEG:
+	reg = result(def);
+
+	if (locations[uses[0]].reg != reg)
+	    ostr << "\tmovl\t" << locations[uses[0]] << ", " << reg << "\n";
+
+	ostr << "\tnegl\t" << reg << "\n";
+	finish(ostr, reg, def);
+	break;
+
+    case EQ: case NE: case LT: case GT: case LE: case GE:
+	condition = compare(ostr, insn->_opcode, uses[0], uses[1]);
+	reg = result(def);
+	ostr << "\tset" << suffixes[condition - EQ] << "\t%al\n";
+	ostr << "\tmovzbl\t%al, " << reg << "\n";
+	finish(ostr, reg, def);
+	break;
+
+    case CALL:
+	numBytes = uses.size() * SIZEOF_ARG;
+
+	if (numBytes % STACK_ALIGNMENT != 0) {
+	    ostr << "\tsubl\t$" << STACK_ALIGNMENT - numBytes % STACK_ALIGNMENT << ", %esp\n";
+	    numBytes += STACK_ALIGNMENT - numBytes % STACK_ALIGNMENT;
+	}
+
+	for (int i = uses.size() - 1; i >= 0; i --)
+	    ostr << "\tpushl\t" << locations[uses[i]] << "\n";
+
+	ostr << "\tcall\t" << global_prefix << insn->_symbol->name() << "\n";
+
+	if (numBytes > 0)
+	    ostr << "\taddl\t$" << numBytes << ", %esp\n";
+
+	if (counts[def] > 0)
+	    finish(ostr, &eax, def);
+
+	break;
+
+    case PHI:
+	assert(0);
+	break;
+
+    case JMP:
+	if (insn->_targets[0] != next)
+	    ostr << "\tjmp\t" << insn->_targets[0]->_label << "\n";
+
+	break;
+
+    case BR:
+	condition = compare(ostr, insn->_condition, uses[0], uses[1]);
+
+	if (insn->_targets[0] == next)
+	    ostr << "\tj" << suffixes[invert(condition) - EQ] << "\t" << insn->_targets[1]->_label << "\n";
+	else {
+	    ostr << "\tj" << suffixes[condition - EQ] << "\t" << insn->_targets[0]->_label << "\n";
+
+	    if (insn->_targets[1] != next)
+		ostr << "\tjmp\t" << insn->_targets[1]->_label << "\n";
+	}
+
+	break;
+
+    case RET:
+	if (!uses.empty() && locations[uses[0]].reg != &eax)
+	    ostr << "\tmovl\t" << locations[uses[0]] << ", %eax\n";
+
+	if (next != nullptr)
+	    ostr << "\tjmp\t" << global_prefix << id->name() << ".exit\n";
+
+	break;
+    }
+}
+
+
+/*
+ * Function:	Procedure::select
+ *
+ * Description:	Write the x86 instructions for this procedure, including
+ *		the prologue and epilogue.  The given offset is the last
+ *		one used by the local variables.
+ */
+
+void Procedure::select(ostream &ostr, int offset)
+{
+    vector<Interval> intervals;
+    vector<unsigned> calls;
+    vector<Register *> saved;
+    vector<int> slots;
+    BasicBlock *next;
+    Atom name = _id->name();
+
+
+    /* Replace the phis, coalesce the copies, and count how often each
+       temporary is used. */
+
+    eliminatePhis(this);
+    counts.assign(_temps + 1, 0);
+    locations.assign(_temps + 1, Location {nullptr, 0, false, 0});
+    scratch = 0;
+
+    for (auto block : _blocks)
+	for (auto insn : block->_insns)
+	    if (insn->_opcode == CONSTANT) {
+		locations[insn->_def].immediate = true;
+		locations[insn->_def].value = insn->_value;
+	    }
+
+    coalesce(this);
+
+    for (auto block : _blocks)
+	for (auto insn : block->_insns)
+	    for (auto t : insn->_uses)
+		counts[t] ++;
+
+
+    /* Allocate the temporaries and save any callee-saved registers. */
+
+    findHomes(this);
+    computeIntervals(this, intervals, calls);
+    saved = allocate(intervals, offset);
+
+    ostr << global_prefix << name << ":\n";
+    ostr << "\tpushl\t%ebp\n";
+    ostr << "\tmovl\t%esp, %ebp\n";
+    ostr << "\tsubl\t$" << name << ".size, %esp\n";
+
+    for (auto reg : saved) {
+	offset -= SIZEOF_REG;
+	slots.push_back(offset);
+	ostr << "\tmovl\t" << reg << ", " << offset << "(%ebp)\n";
+    }
+
+
+    /* Write each block, skipping any unused results. */
+
+    for (unsigned i = 0; i < _blocks.size(); i ++) {
+	next = i + 1 < _blocks.size() ? _blocks[i + 1] : nullptr;
+
+	if (i > 0)
+	    ostr << _blocks[i]->_label << ":\n";
+
+	for (auto insn : _blocks[i]->_insns)
+	    if (!insn->isPure() || counts[insn->_def] > 0)
+		::select(ostr, insn, next, _id, offset);
+    }
+
+
+    /* Restore the callee-saved registers and return. */
+
+    ostr << "\n" << global_prefix << name << ".exit:\n";
+
+    for (unsigned i = 0; i < saved.size(); i ++)
+	ostr << "\tmovl\t" << slots[i] << "(%ebp), " << saved[i] << "\n";
+
+    ostr << "\tmovl\t%ebp, %esp\n";
+    ostr << "\tpopl\t%ebp\n";
+    ostr << "\tret\n\n";
+
+    while ((offset - 2 * SIZEOF_REG) % STACK_ALIGNMENT != 0)
+	offset --;
+
+    ostr << "\t.set\t" << name << ".size, " << -offset << "\n";
+    ostr << "\t.globl\t" << global_prefix << name << "\n\n";
+}
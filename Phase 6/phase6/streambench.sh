@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# File:		streambench.sh
+#
+# Description:	Measure the peak memory used by the compiler as the number
+#		of functions in a file grows.  Files of one thousand, ten
+#		thousand, and one hundred thousand functions are written,
+#		or of the numbers given, with each function having loops,
+#		an array, and a string literal of its own.  Each file is
+#		compiled with --stats, and the peak resident memory is
+#		reported, which should stay flat as the file grows.  The
+#		compiler is ./scc unless another is given by SCC.
+#
+# Usage:	sh streambench.sh [functions ...]
+#
+
+SCC=${SCC:-./scc}
+TMP=${TMPDIR:-/tmp}/streambench.$$
+
+trap 'rm -rf $TMP' 0 1 2 15
+mkdir $TMP || exit 1
+
+for N in ${*:-1000 10000 100000}; do
+    awk -v n=$N 'BEGIN {
+	printf "int printf();\nint g[100];\n"
+
+	for (i = 0; i < n; i ++) {
+	    printf "\nint f%d(int a, int b)\n{\n", i
+	    printf "    int i, s, t, arr[10];\n    s = 0;\n"
+	    printf "    for (i = 0; i < 10; i = i + 1) {\n"
+	    printf "\tarr[i] = a * i + b - %d;\n", i % 7
+	    printf "\tt = arr[i] / 3 + arr[i] %% 5;\n"
+	    printf "\tif (t > 4 && t < 100 || s == %d) s = s + t * 2; else s = s - 1;\n", i % 11
+	    printf "\twhile (t > 0) t = t - 3;\n    }\n"
+	    printf "    if (s < -1000) printf(\"f%d: %%d\\n\", s);\n", i
+	    printf "    g[%d] = s;\n", i % 100
+	    printf "    return s + a * b - (a - b) * (a + b);\n}\n"
+	}
+
+	printf "\nint main(void)\n{\n    int s;\n    s = 0;\n"
+
+	for (i = 0; i < n && i < 1000; i += 20)
+	    printf "    s = s + f%d(0, %d);\n", i, i % 3
+
+	printf "    printf(\"%%d\\n\", s);\n}\n"
+    }' > $TMP/functions.c || exit 1
+
+    printf "%d functions: " $N
+    "$SCC" --stats -o /dev/null $TMP/functions.c 2>&1 | grep "peak RSS"
+done